@@ -0,0 +1,631 @@
+#include "collision_audit.h"
+#include "fnv1a.h"
+#include "name_list.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+
+namespace {
+
+// 输入按块分给各线程，块边界对齐到行（或标识符）边界
+const size_t AUDIT_CHUNK_SIZE = 1 << 20;
+// 每个块最多 AUDIT_CHUNK_SIZE / 2 个名字，内存预算至少要放得下一个块的 (hash, id) 对和排序用的临时空间
+const size_t AUDIT_MIN_MEMORY = 4 * AUDIT_CHUNK_SIZE * sizeof(HashPair);
+// 归并时每个 run 的读缓冲区下限
+const size_t AUDIT_MIN_READ_BUFFER = 64 << 10;
+// 小于这个规模时单线程排序更快
+const size_t RADIX_PARALLEL_MIN = 1 << 16;
+
+unsigned resolve_threads(unsigned threads) {
+    return threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads;
+}
+
+// 在 threads 个线程上执行 fn(t)，当前线程执行 t = 0
+template <typename F>
+void run_on_threads(unsigned threads, F&& fn) {
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) {
+        pool.emplace_back([&fn, t]() { fn(t); });
+    }
+    fn(0);
+    for (auto& th : pool) {
+        th.join();
+    }
+}
+
+// --- 输入文件 ---
+
+struct AuditInput {
+    std::string path;
+    const char* data = nullptr;
+    size_t size = 0;
+};
+
+struct AuditChunk {
+    uint32_t file;
+    size_t begin;
+    size_t end;
+};
+
+class AuditInputs {
+public:
+    AuditInputs() = default;
+    AuditInputs(const AuditInputs&) = delete;
+    AuditInputs& operator=(const AuditInputs&) = delete;
+    ~AuditInputs() {
+        for (auto& input : m_inputs) {
+            if (input.size > 0) {
+                munmap((void*)input.data, input.size);
+            }
+        }
+    }
+
+    bool open(const std::string& path) {
+        if (m_inputs.size() >= AUDIT_MAX_FILES) {
+            std::cerr << "Error: too many input files (max " << AUDIT_MAX_FILES << ")\n";
+            return false;
+        }
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            std::cerr << fmt::format("Error: {}: {}\n", path, strerror(errno));
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (uint64_t)st.st_size > AUDIT_ID_OFFSET_MASK) {
+            std::cerr << fmt::format("Error: {}: not a regular file or too large\n", path);
+            close(fd);
+            return false;
+        }
+
+        AuditInput input;
+        input.path = path;
+        if (st.st_size > 0) {
+            void* map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED) {
+                std::cerr << fmt::format("Error: {}: mmap failed: {}\n", path, strerror(errno));
+                close(fd);
+                return false;
+            }
+            // 先顺序扫描一遍，报告碰撞时才回来随机读取少量名字
+            madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+            input.data = (const char*)map;
+            input.size = (size_t)st.st_size;
+        }
+        close(fd);
+        m_inputs.push_back(input);
+        return true;
+    }
+
+    // 把每个文件切成约 AUDIT_CHUNK_SIZE 的块，边界处不会切断名字
+    std::vector<AuditChunk> split(bool scan) const {
+        std::vector<AuditChunk> chunks;
+        for (uint32_t f = 0; f < m_inputs.size(); ++f) {
+            const char* data = m_inputs[f].data;
+            const size_t size = m_inputs[f].size;
+            size_t begin = 0;
+            while (begin < size) {
+                size_t end = std::min(size, begin + AUDIT_CHUNK_SIZE);
+                if (scan) {
+                    while (end < size && is_c_ident_char(data[end])) {
+                        ++end;
+                    }
+                } else {
+                    while (end < size && data[end - 1] != '\n') {
+                        ++end;
+                    }
+                }
+                chunks.push_back(AuditChunk{f, begin, end});
+                begin = end;
+            }
+        }
+        return chunks;
+    }
+
+    std::string_view name(uint64_t id, bool scan) const {
+        const AuditInput& input = m_inputs[id >> AUDIT_ID_FILE_SHIFT];
+        size_t offset = (size_t)(id & AUDIT_ID_OFFSET_MASK);
+        return std::string_view(input.data + offset, name_length_at(input.data, input.size, offset, scan));
+    }
+
+    const AuditInput& operator[](size_t i) const {
+        return m_inputs[i];
+    }
+
+    uint64_t total_bytes() const {
+        uint64_t total = 0;
+        for (const auto& input : m_inputs) {
+            total += input.size;
+        }
+        return total;
+    }
+
+private:
+    std::vector<AuditInput> m_inputs;
+};
+
+// --- 已排序的 run ---
+
+// 写入临时文件的 run；文件创建后立即 unlink，进程退出时自动回收
+struct SpilledRun {
+    int fd = -1;
+    uint64_t count = 0;
+};
+
+bool write_all(int fd, const void* data, size_t len) {
+    const char* p = (const char*)data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+bool spill_run(const std::string& tmpdir, const HashPair* pairs, size_t count, SpilledRun& run) {
+    std::string templ = tmpdir + "/fnv-audit-XXXXXX";
+    int fd = mkstemp(&templ[0]);
+    if (fd < 0) {
+        std::cerr << fmt::format("Error: cannot create a temporary file in {}: {}\n", tmpdir, strerror(errno));
+        return false;
+    }
+    unlink(templ.c_str());
+    if (!write_all(fd, pairs, count * sizeof(HashPair))) {
+        std::cerr << fmt::format("Error: writing a sorted run to {} failed: {}\n", tmpdir, strerror(errno));
+        close(fd);
+        return false;
+    }
+    // 只会顺序读回一次，不需要占着页缓存
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    run.fd = fd;
+    run.count = count;
+    return true;
+}
+
+// 顺序读取一个 run：临时文件用 pread 分批读入缓冲区，内存中的 run 直接访问
+class RunReader {
+public:
+    RunReader(const HashPair* pairs, size_t count) : m_pairs(pairs), m_remaining(count), m_avail(count) {}
+
+    RunReader(const SpilledRun& run, size_t buffer_pairs)
+        : m_fd(run.fd), m_remaining(run.count), m_buffer(buffer_pairs) {
+        posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    bool empty() const {
+        return m_avail == 0;
+    }
+
+    const HashPair& front() const {
+        return m_pairs[m_pos];
+    }
+
+    // 前进一个元素；读临时文件出错时返回 false
+    bool pop() {
+        ++m_pos;
+        --m_avail;
+        --m_remaining;
+        return m_avail > 0 || m_remaining == 0 || refill();
+    }
+
+    bool refill() {
+        if (m_fd < 0 || m_remaining == 0) {
+            return true;
+        }
+        size_t want = (size_t)std::min<uint64_t>(m_remaining, m_buffer.size()) * sizeof(HashPair);
+        size_t got = 0;
+        char* dst = (char*)m_buffer.data();
+        while (got < want) {
+            ssize_t n = pread(m_fd, dst + got, want - got, (off_t)m_file_offset);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            got += (size_t)n;
+            m_file_offset += (uint64_t)n;
+        }
+        m_pairs = m_buffer.data();
+        m_pos = 0;
+        m_avail = want / sizeof(HashPair);
+        return true;
+    }
+
+private:
+    int m_fd = -1;
+    const HashPair* m_pairs = nullptr;
+    size_t m_pos = 0;
+    uint64_t m_remaining = 0; // 包括缓冲区中尚未取走的
+    size_t m_avail = 0;       // 缓冲区中尚未取走的
+    uint64_t m_file_offset = 0;
+    std::vector<HashPair> m_buffer;
+};
+
+// --- 碰撞检查 ---
+
+struct AuditStats {
+    uint64_t keys = 0;
+    uint64_t unique = 0;
+    uint64_t duplicates = 0;
+    uint64_t collisions = 0; // 出现碰撞的哈希值个数
+};
+
+// 依次接收按 hash 排序的 (hash, id)，hash 相同的一组结束时比较其中的字符串
+class GroupScanner {
+public:
+    GroupScanner(const AuditInputs& inputs, bool scan, AuditStats& stats)
+        : m_inputs(inputs), m_scan(scan), m_stats(stats) {}
+
+    void push(const HashPair& pair) {
+        if (m_count > 0 && pair.hash != m_hash) {
+            finish();
+        }
+        if (m_count == 0) {
+            // 绝大多数哈希值只出现一次，此时不需要回到输入文件中读取名字
+            m_hash = pair.hash;
+            m_first_id = pair.id;
+            m_names.clear();
+        } else {
+            if (m_count == 1) {
+                m_names.push_back(m_inputs.name(m_first_id, m_scan));
+            }
+            // 同一哈希下不同的名字通常最多一个，线性查找即可，不需要保存整组 id
+            std::string_view name = m_inputs.name(pair.id, m_scan);
+            if (std::find(m_names.begin(), m_names.end(), name) == m_names.end()) {
+                m_names.push_back(name);
+            }
+        }
+        m_count++;
+    }
+
+    void finish() {
+        if (m_count == 0) {
+            return;
+        }
+        const uint64_t distinct = std::max<uint64_t>(1, m_names.size());
+        m_stats.keys += m_count;
+        m_stats.unique += distinct;
+        m_stats.duplicates += m_count - distinct;
+        if (m_names.size() > 1) {
+            m_stats.collisions++;
+            std::sort(m_names.begin(), m_names.end());
+            std::string line = fmt::format("0x{:016X}", m_hash);
+            for (const auto& name : m_names) {
+                line += fmt::format("  {}", name);
+            }
+            std::cout << line << "\n";
+        }
+        m_count = 0;
+    }
+
+private:
+    const AuditInputs& m_inputs;
+    bool m_scan;
+    AuditStats& m_stats;
+    uint64_t m_hash = 0;
+    uint64_t m_count = 0;
+    uint64_t m_first_id = 0;
+    std::vector<std::string_view> m_names;
+};
+
+// --- 生成 (hash, id) 对 ---
+
+void hash_chunk(const AuditInputs& inputs, const AuditChunk& chunk, bool scan, const std::string& prefix,
+                std::vector<std::string_view>& views, std::vector<uint64_t>& offsets,
+                std::vector<uint64_t>& hashes) {
+    const AuditInput& input = inputs[chunk.file];
+    const char* base = input.data + chunk.begin;
+    views.clear();
+    offsets.clear();
+    for_each_name(base, chunk.end - chunk.begin, scan, prefix, [&](size_t offset, size_t len) {
+        views.emplace_back(base + offset, len);
+        offsets.push_back(chunk.begin + offset);
+    });
+    hashes.resize(views.size());
+    fnv1a_64_batch(views.data(), views.size(), hashes.data());
+}
+
+// 用 pending 中的块填充 buffer，直到块用完或 buffer 放不下下一个块。
+// 各线程先把一个块的结果放进自己的缓冲区，再原子地在 buffer 中预留位置拷贝过去；
+// 预留区间按顺序分配，所以放得下的区间一定是 buffer 开头连续的一段。
+// 返回填入的个数，没处理或放不下的块留在 pending 中。
+size_t fill_run(const AuditInputs& inputs, const std::vector<AuditChunk>& chunks, std::vector<uint32_t>& pending,
+                bool scan, const std::string& prefix, HashPair* buffer, size_t capacity, unsigned threads) {
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> reserved(0);
+    std::atomic<size_t> filled(0);
+    std::atomic<bool> full(false);
+    std::mutex retry_mutex;
+    std::vector<uint32_t> retry;
+
+    run_on_threads(threads, [&](unsigned) {
+        std::vector<std::string_view> views;
+        std::vector<uint64_t> offsets;
+        std::vector<uint64_t> hashes;
+        while (!full.load(std::memory_order_relaxed)) {
+            size_t i = next++;
+            if (i >= pending.size()) {
+                break;
+            }
+            const AuditChunk& chunk = chunks[pending[i]];
+            hash_chunk(inputs, chunk, scan, prefix, views, offsets, hashes);
+
+            const size_t count = hashes.size();
+            size_t pos = reserved.fetch_add(count);
+            if (pos + count > capacity) {
+                full = true;
+                std::lock_guard<std::mutex> lock(retry_mutex);
+                retry.push_back(pending[i]);
+                continue;
+            }
+            const uint64_t file_bits = (uint64_t)chunk.file << AUDIT_ID_FILE_SHIFT;
+            for (size_t k = 0; k < count; ++k) {
+                buffer[pos + k] = HashPair{hashes[k], file_bits | offsets[k]};
+            }
+            filled += count;
+        }
+    });
+
+    size_t taken = std::min(next.load(), pending.size());
+    retry.insert(retry.end(), pending.begin() + taken, pending.end());
+    pending.swap(retry);
+    return filled.load();
+}
+
+void audit_usage() {
+    std::cout << "Usage: FNV-1a-64bit audit [options] <input>...\n";
+    std::cout << "  Hash every name in the inputs and report fnv1a_64 collisions (equal hash, different name)\n";
+    std::cout << "  on stdout, one line per hash. Exit status is 1 if any collision is found.\n";
+    std::cout << "  -s, --scan PREFIX    scan inputs as C sources for identifiers starting with PREFIX\n";
+    std::cout << "                       (default: inputs are name lists, one name per line)\n";
+    std::cout << "  -j, --threads N      worker threads (default: all cores)\n";
+    std::cout << "  -m, --memory MB      memory for (hash, id) pairs; sorted runs beyond it are spilled\n";
+    std::cout << "                       to disk (default: 1/4 of physical memory)\n";
+    std::cout << "  -T, --tmpdir DIR     directory for spilled runs (default: $TMPDIR or /tmp)\n";
+}
+
+double seconds_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace
+
+void radix_sort_pairs(HashPair* data, HashPair* scratch, size_t n, unsigned threads) {
+    const size_t RADIX = 256;
+    threads = resolve_threads(threads);
+    if (n < RADIX_PARALLEL_MIN) {
+        threads = 1;
+    }
+    threads = (unsigned)std::min<size_t>(threads, std::max<size_t>(1, n));
+
+    auto slice_begin = [&](unsigned t) { return n * t / threads; };
+    std::vector<size_t> counts(threads * RADIX);
+    HashPair* src = data;
+    HashPair* dst = scratch;
+
+    for (unsigned shift = 0; shift < 64; shift += 8) {
+        run_on_threads(threads, [&](unsigned t) {
+            size_t* count = &counts[t * RADIX];
+            std::fill(count, count + RADIX, 0);
+            for (size_t i = slice_begin(t), end = slice_begin(t + 1); i < end; ++i) {
+                count[(src[i].hash >> shift) & 0xFF]++;
+            }
+        });
+
+        // 转换成写入位置：数字小的在前，同一数字内线程序号小的在前，保证稳定
+        bool skip = false;
+        size_t offset = 0;
+        for (size_t d = 0; d < RADIX; ++d) {
+            size_t digit_total = 0;
+            for (unsigned t = 0; t < threads; ++t) {
+                size_t c = counts[t * RADIX + d];
+                counts[t * RADIX + d] = offset;
+                offset += c;
+                digit_total += c;
+            }
+            skip = skip || digit_total == n;
+        }
+        if (skip) {
+            continue; // 这 8 位全都相同，顺序不变
+        }
+
+        run_on_threads(threads, [&](unsigned t) {
+            size_t* pos = &counts[t * RADIX];
+            for (size_t i = slice_begin(t), end = slice_begin(t + 1); i < end; ++i) {
+                const HashPair& p = src[i];
+                dst[pos[(p.hash >> shift) & 0xFF]++] = p;
+            }
+        });
+        std::swap(src, dst);
+    }
+
+    if (src != data) {
+        std::copy(src, src + n, data);
+    }
+}
+
+int run_audit(int argc, char* argv[]) {
+    std::string scan_prefix;
+    bool scan = false;
+    unsigned threads = 0;
+    size_t memory = 0;
+    const char* env_tmpdir = getenv("TMPDIR");
+    std::string tmpdir = (env_tmpdir != nullptr && *env_tmpdir != '\0') ? env_tmpdir : "/tmp";
+    std::vector<std::string> paths;
+
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            audit_usage();
+            return 0;
+        } else if ((arg == "-s" || arg == "--scan") && i + 1 < argc) {
+            scan = true;
+            scan_prefix = argv[++i];
+        } else if ((arg == "-j" || arg == "--threads") && i + 1 < argc) {
+            threads = (unsigned)std::stoul(argv[++i]);
+        } else if ((arg == "-m" || arg == "--memory") && i + 1 < argc) {
+            memory = (size_t)std::stoull(argv[++i]) << 20;
+        } else if ((arg == "-T" || arg == "--tmpdir") && i + 1 < argc) {
+            tmpdir = argv[++i];
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        audit_usage();
+        return 1;
+    }
+
+    threads = resolve_threads(threads);
+    if (memory == 0) {
+        memory = (size_t)sysconf(_SC_PHYS_PAGES) * (size_t)sysconf(_SC_PAGESIZE) / 4;
+    }
+    memory = std::max(memory, AUDIT_MIN_MEMORY);
+
+    auto t0 = std::chrono::steady_clock::now();
+    AuditInputs inputs;
+    for (const auto& path : paths) {
+        if (!inputs.open(path)) {
+            return 1;
+        }
+    }
+    std::vector<AuditChunk> chunks = inputs.split(scan);
+    std::vector<uint32_t> pending(chunks.size());
+    for (uint32_t i = 0; i < pending.size(); ++i) {
+        pending[i] = i;
+    }
+
+    // 一半放 (hash, id) 对，一半是基数排序的临时空间；每个名字连同分隔符至少占 2 字节，
+    // 输入不大时按名字个数的上限分配。不做初始化，只有实际写入的页才会占用内存
+    const size_t max_names = inputs.total_bytes() / 2 + paths.size();
+    const size_t capacity = std::max<size_t>(1, std::min(memory / (2 * sizeof(HashPair)), max_names));
+    std::unique_ptr<HashPair[]> buffer(new HashPair[capacity]);
+    std::unique_ptr<HashPair[]> scratch(new HashPair[capacity]);
+    std::vector<SpilledRun> runs;
+    size_t last_count = 0;
+    double hash_seconds = 0;
+    double sort_seconds = 0;
+    double spill_seconds = 0;
+    bool ok = true;
+
+    while (ok) {
+        auto t = std::chrono::steady_clock::now();
+        size_t count = fill_run(inputs, chunks, pending, scan, scan_prefix, buffer.get(), capacity, threads);
+        hash_seconds += seconds_since(t);
+
+        t = std::chrono::steady_clock::now();
+        radix_sort_pairs(buffer.get(), scratch.get(), count, threads);
+        sort_seconds += seconds_since(t);
+
+        if (count == 0 && !pending.empty()) {
+            std::cerr << "Error: --memory is too small to hold a single input chunk.\n";
+            ok = false;
+            break;
+        }
+        if (pending.empty()) {
+            // 最后一个 run 留在内存中直接参与归并
+            last_count = count;
+            break;
+        }
+        t = std::chrono::steady_clock::now();
+        SpilledRun run;
+        ok = spill_run(tmpdir, buffer.get(), count, run);
+        if (ok) {
+            runs.push_back(run);
+        }
+        spill_seconds += seconds_since(t);
+    }
+
+    AuditStats stats;
+    auto t_merge = std::chrono::steady_clock::now();
+    if (ok) {
+        // 归并阶段不再需要排序的临时空间，把它分给各个 run 做读缓冲区
+        scratch.reset();
+        const size_t read_pairs =
+            std::max(AUDIT_MIN_READ_BUFFER, memory / 2 / std::max<size_t>(1, runs.size())) / sizeof(HashPair);
+
+        std::vector<RunReader> readers;
+        readers.reserve(runs.size() + 1);
+        for (const auto& run : runs) {
+            readers.emplace_back(run, read_pairs);
+        }
+        readers.emplace_back(buffer.get(), last_count);
+
+        // 小根堆：(当前 hash, reader 序号)
+        typedef std::pair<uint64_t, size_t> HeapItem;
+        std::priority_queue<HeapItem, std::vector<HeapItem>, std::greater<HeapItem>> heap;
+        for (size_t r = 0; r < readers.size() && ok; ++r) {
+            ok = readers[r].refill();
+            if (ok && !readers[r].empty()) {
+                heap.push(HeapItem(readers[r].front().hash, r));
+            }
+        }
+
+        GroupScanner scanner(inputs, scan, stats);
+        while (ok && !heap.empty()) {
+            size_t r = heap.top().second;
+            heap.pop();
+            RunReader& reader = readers[r];
+            // 同一个 run 内 hash 相同的元素是连续的，一次全部取走
+            const uint64_t hash = reader.front().hash;
+            do {
+                scanner.push(reader.front());
+                ok = reader.pop();
+            } while (ok && !reader.empty() && reader.front().hash == hash);
+            if (ok && !reader.empty()) {
+                heap.push(HeapItem(reader.front().hash, r));
+            }
+        }
+        scanner.finish();
+        if (!ok) {
+            std::cerr << fmt::format("Error: reading a sorted run back failed: {}\n", strerror(errno));
+        }
+    }
+    double merge_seconds = seconds_since(t_merge);
+
+    uint64_t spilled = 0;
+    for (const auto& run : runs) {
+        spilled += run.count * sizeof(HashPair);
+        close(run.fd);
+    }
+    if (!ok) {
+        return 1;
+    }
+
+    // 理想的64位哈希下 n 个不同的名字中出现碰撞的期望对数约为 n^2 / 2^65
+    const double expected = (double)stats.unique * (double)stats.unique / ldexp(1.0, 65);
+    std::cerr << fmt::format("audit: {} names ({} unique, {} duplicates) from {:.1f} MB in {} file(s), {} thread(s)\n",
+                             stats.keys, stats.unique, stats.duplicates, (double)inputs.total_bytes() / (1 << 20),
+                             paths.size(), threads);
+    std::cerr << fmt::format("audit: {} sorted run(s), {:.1f} MB spilled to {}\n", runs.size() + 1,
+                             (double)spilled / (1 << 20), runs.empty() ? "(none)" : tmpdir);
+    std::cerr << fmt::format("audit: hash {:.3f} s, sort {:.3f} s, spill {:.3f} s, merge {:.3f} s, total {:.3f} s\n",
+                             hash_seconds, sort_seconds, spill_seconds, merge_seconds, seconds_since(t0));
+    std::cerr << fmt::format("audit: {} colliding hash value(s) (expected for an ideal 64-bit hash: {:.2g})\n",
+                             stats.collisions, expected);
+    return stats.collisions > 0 ? 1 : 0;
+}
@@ -0,0 +1,42 @@
+#ifndef COLLISION_AUDIT_H
+#define COLLISION_AUDIT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 大规模 fnv1a_64 碰撞审计（audit 模式）
+//
+// 对数百万个标识符逐一计算哈希，得到 (hash, id) 对，按 hash 排序后相邻比较：
+// 哈希相同而字符串不同即为碰撞，字符串也相同只是重复出现。
+//
+// id 由输入文件序号和名字在文件中的偏移组成（见 AUDIT_ID_FILE_SHIFT），名字本身不进入排序，
+// 需要时从 mmap 的输入文件中取回。内存中只保存 16 字节的 (hash, id) 对，
+// 超过内存预算时把已排序的段（run）写入临时文件，最后做多路归并。
+
+// id 的高 20 位是输入文件序号，低 44 位是文件内偏移
+const unsigned AUDIT_ID_FILE_SHIFT = 44;
+const uint64_t AUDIT_ID_OFFSET_MASK = (1ULL << AUDIT_ID_FILE_SHIFT) - 1;
+const size_t AUDIT_MAX_FILES = 1u << (64 - AUDIT_ID_FILE_SHIFT);
+
+struct HashPair {
+    uint64_t hash;
+    uint64_t id;
+};
+static_assert(sizeof(HashPair) == 16, "HashPair must be 16 bytes");
+
+/**
+ * @brief 多线程 LSD 基数排序，按 hash 升序排列（稳定，hash 相同的保持原有顺序）。
+ *
+ * 每一轮处理 8 位：各线程先统计自己那一段的直方图，再按 (数字, 线程) 的顺序算出写入位置，
+ * 最后各自分散写入。所有元素这一位都相同的轮次直接跳过。
+ *
+ * @param data    待排序的数据，结果也在这里。
+ * @param scratch 与 data 等长的临时空间。
+ * @param threads 线程数，0 表示使用全部硬件线程。
+ */
+void radix_sort_pairs(HashPair* data, HashPair* scratch, size_t n, unsigned threads);
+
+// 命令行入口：FNV-1a-64bit audit ...
+int run_audit(int argc, char* argv[]);
+
+#endif // COLLISION_AUDIT_H
@@ -0,0 +1,30 @@
+#ifndef FILE_HASH_H
+#define FILE_HASH_H
+
+#include <stdint.h>
+#include <string>
+
+/**
+ * @brief 以 mmap + MADV_SEQUENTIAL 的方式对整个文件做一次顺序的 FNV-1a 64位哈希，
+ *        数据直接从页缓存读取，没有中间拷贝。无法 mmap 的输入（管道、"-" 表示的 stdin）
+ *        退回到 read() 循环。
+ *
+ * @param path  文件路径，"-" 表示标准输入。
+ * @param hash  输出的哈希值。
+ * @param bytes 输出的文件大小（字节）。
+ * @return      成功返回 true，失败时 errno 保留出错原因。
+ */
+bool fnv1a_64_file(const std::string& path, uint64_t& hash, uint64_t& bytes);
+
+/**
+ * @brief 与 fnv1a_64_file 相同的读取方式，但计算树哈希（见 tree_hash.h），
+ *        各块由 threads 个线程并行计算。
+ *
+ * @param threads 线程数，0 表示使用全部硬件线程。
+ */
+bool fnv1a_64_tree_file(const std::string& path, unsigned threads, uint64_t& hash, uint64_t& bytes);
+
+// 命令行入口：FNV-1a-64bit hash [--tree] [-j N] <file>...
+int run_hash_files(int argc, char* argv[]);
+
+#endif // FILE_HASH_H
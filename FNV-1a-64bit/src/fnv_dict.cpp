@@ -0,0 +1,524 @@
+#include "fnv_dict.h"
+#include "name_list.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <fmt/format.h>
+
+namespace {
+
+// 按中序遍历把有序数组填入 Eytzinger 顺序（下标从 1 开始）
+size_t fill_eytzinger(const std::vector<FnvDictRecord>& sorted, std::vector<FnvDictRecord>& out,
+                      size_t i, size_t k) {
+    if (k < out.size()) {
+        i = fill_eytzinger(sorted, out, i, 2 * k);
+        out[k] = sorted[i++];
+        i = fill_eytzinger(sorted, out, i, 2 * k + 1);
+    }
+    return i;
+}
+
+// --- dict-decode：在日志中查找 16 位十六进制的消息 ID 并替换成名字 ---
+
+const size_t DECODE_BLOCK_SIZE = 4 << 20;
+const size_t OUTPUT_BUFFER_SIZE = 1 << 20;
+
+// 0：分隔符；1：标识符字符但不是十六进制数字；2：十六进制数字
+struct CharClass {
+    uint8_t table[256];
+    CharClass() {
+        for (int c = 0; c < 256; ++c) {
+            table[c] = is_c_ident_char((char)c) ? 1 : 0;
+        }
+        for (const char* p = "0123456789abcdefABCDEF"; *p; ++p) {
+            table[(uint8_t)*p] = 2;
+        }
+    }
+};
+const CharClass char_class;
+
+inline uint64_t parse_hex16(const char* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 16; ++i) {
+        char c = p[i];
+        uint64_t d = (c <= '9') ? (uint64_t)(c - '0') : (uint64_t)((c | 0x20) - 'a' + 10);
+        v = (v << 4) | d;
+    }
+    return v;
+}
+
+class OutputBuffer {
+public:
+    explicit OutputBuffer(int fd) : m_fd(fd) {
+        m_buffer.reserve(OUTPUT_BUFFER_SIZE);
+    }
+    ~OutputBuffer() {
+        flush();
+    }
+
+    void append(const char* data, size_t len) {
+        if (m_buffer.size() + len > OUTPUT_BUFFER_SIZE) {
+            flush();
+            if (len >= OUTPUT_BUFFER_SIZE) {
+                write_all(data, len);
+                return;
+            }
+        }
+        m_buffer.insert(m_buffer.end(), data, data + len);
+    }
+
+    void flush() {
+        write_all(m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+    }
+
+    bool failed() const {
+        return m_failed;
+    }
+
+private:
+    void write_all(const char* data, size_t len) {
+        while (len > 0 && !m_failed) {
+            ssize_t n = write(m_fd, data, len);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                m_failed = true;
+                return;
+            }
+            data += n;
+            len -= (size_t)n;
+        }
+    }
+
+    int m_fd;
+    bool m_failed = false;
+    std::vector<char> m_buffer;
+};
+
+struct DecodeStats {
+    uint64_t bytes = 0;
+    uint64_t ids = 0;
+    uint64_t unknown = 0;
+};
+
+// 一段文本中待查找的消息 ID
+struct PendingId {
+    size_t start;
+    size_t end;
+    uint64_t hash;
+};
+
+const size_t DECODE_BATCH = 64;
+
+// 批量查找已收集的 ID，并按顺序输出到 emitted..最后一个 ID 为止的文本
+void flush_pending(const FnvDict& dict, const char* p, std::vector<PendingId>& pending, size_t& emitted,
+                   OutputBuffer& out, DecodeStats& stats) {
+    if (pending.empty()) {
+        return;
+    }
+    uint64_t hashes[DECODE_BATCH] = {};
+    std::string_view names[DECODE_BATCH];
+    for (size_t i = 0; i < pending.size(); ++i) {
+        hashes[i] = pending[i].hash;
+    }
+    dict.lookup_batch(hashes, pending.size(), names);
+
+    for (size_t i = 0; i < pending.size(); ++i) {
+        if (names[i].empty()) {
+            stats.unknown++;
+            continue;
+        }
+        out.append(p + emitted, pending[i].start - emitted);
+        out.append(names[i].data(), names[i].size());
+        emitted = pending[i].end;
+    }
+    stats.ids += pending.size();
+    pending.clear();
+}
+
+// 处理一段完整的文本（调用者保证末尾不会截断一个标识符）
+void decode_text(const FnvDict& dict, const char* p, size_t n, OutputBuffer& out, DecodeStats& stats) {
+    const uint8_t* cls = char_class.table;
+    std::vector<PendingId> pending;
+    pending.reserve(DECODE_BATCH);
+    size_t emitted = 0;
+    size_t i = 0;
+    while (i < n) {
+        if (cls[(uint8_t)p[i]] == 0) {
+            ++i;
+            continue;
+        }
+        size_t start = i;
+        bool all_hex = true;
+        while (i < n && cls[(uint8_t)p[i]] != 0) {
+            all_hex = all_hex && cls[(uint8_t)p[i]] == 2;
+            ++i;
+        }
+
+        const size_t len = i - start;
+        const char* digits = nullptr;
+        if (len == 16 && all_hex) {
+            digits = p + start;
+        } else if (len == 18 && p[start] == '0' && (p[start + 1] | 0x20) == 'x') {
+            bool hex = true;
+            for (size_t k = start + 2; k < i && hex; ++k) {
+                hex = cls[(uint8_t)p[k]] == 2;
+            }
+            digits = hex ? p + start + 2 : nullptr;
+        }
+        if (digits == nullptr) {
+            continue;
+        }
+
+        pending.push_back(PendingId{start, i, parse_hex16(digits)});
+        if (pending.size() == DECODE_BATCH) {
+            flush_pending(dict, p, pending, emitted, out, stats);
+        }
+    }
+    flush_pending(dict, p, pending, emitted, out, stats);
+    out.append(p + emitted, n - emitted);
+    stats.bytes += n;
+}
+
+bool decode_fd(const FnvDict& dict, int fd, OutputBuffer& out, DecodeStats& stats) {
+    // 普通文件直接 mmap，整个文件就是一段完整的文本
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+            decode_text(dict, (const char*)map, (size_t)st.st_size, out, stats);
+            munmap(map, (size_t)st.st_size);
+            return true;
+        }
+    }
+
+    // 管道等：按块读取，块尾未结束的标识符留到下一块再处理
+    std::vector<char> buffer(DECODE_BLOCK_SIZE);
+    size_t filled = 0;
+    while (true) {
+        if (filled == buffer.size()) {
+            buffer.resize(buffer.size() * 2); // 超长的标识符，扩大缓冲区
+        }
+        ssize_t n = read(fd, buffer.data() + filled, buffer.size() - filled);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (n == 0) {
+            decode_text(dict, buffer.data(), filled, out, stats);
+            return true;
+        }
+        filled += (size_t)n;
+
+        size_t cut = filled;
+        while (cut > 0 && char_class.table[(uint8_t)buffer[cut - 1]] != 0) {
+            --cut;
+        }
+        if (cut == 0) {
+            continue;
+        }
+        decode_text(dict, buffer.data(), cut, out, stats);
+        memmove(buffer.data(), buffer.data() + cut, filled - cut);
+        filled -= cut;
+    }
+}
+
+void dict_build_usage() {
+    std::cout << "Usage: FNV-1a-64bit dict-build -o FILE [options] <input>...\n";
+    std::cout << "  -o, --output FILE    dictionary file to write (.fnvd)\n";
+    std::cout << "  -s, --scan PREFIX    scan inputs as C sources for identifiers starting with PREFIX\n";
+    std::cout << "                       (default: inputs are name lists, one name per line)\n";
+    std::cout << "      --sorted         plain sorted layout (binary search) instead of Eytzinger\n";
+}
+
+void dict_decode_usage() {
+    std::cout << "Usage: FNV-1a-64bit dict-decode -d FILE [log]...\n";
+    std::cout << "  -d, --dict FILE      dictionary built by dict-build\n";
+    std::cout << "  Replaces 16-digit hex message IDs (optionally 0x-prefixed) in the logs\n";
+    std::cout << "  (default: stdin) with their names and writes the result to stdout.\n";
+}
+
+} // namespace
+
+bool write_fnv_dict(const std::string& path, const UniqueNames& names, bool eytzinger, std::string& error) {
+    const size_t count = names.names.size();
+
+    std::vector<FnvDictRecord> sorted(count);
+    std::string strings;
+    for (size_t i = 0; i < count; ++i) {
+        if (strings.size() > 0xFFFFFFFFu) {
+            error = "string table exceeds 4 GB";
+            return false;
+        }
+        sorted[i] = FnvDictRecord{names.hashes[i], (uint32_t)strings.size(), (uint32_t)names.names[i].size()};
+        strings += names.names[i];
+        strings += '\0';
+    }
+
+    std::vector<FnvDictRecord> records(count + 1, FnvDictRecord{0, 0, 0});
+    if (eytzinger) {
+        fill_eytzinger(sorted, records, 0, 1);
+    } else {
+        std::copy(sorted.begin(), sorted.end(), records.begin() + 1);
+    }
+
+    FnvDictHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FNV_DICT_MAGIC, sizeof(header.magic));
+    header.version = FNV_DICT_VERSION;
+    header.layout = eytzinger ? FNV_DICT_LAYOUT_EYTZINGER : FNV_DICT_LAYOUT_SORTED;
+    header.count = count;
+    header.strings_size = strings.size();
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        error = "cannot open " + path + " for writing";
+        return false;
+    }
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)records.data(), records.size() * sizeof(FnvDictRecord));
+    out.write(strings.data(), strings.size());
+    if (!out.good()) {
+        error = "write failed: " + path;
+        return false;
+    }
+    return true;
+}
+
+FnvDict::~FnvDict() {
+    if (m_map != nullptr) {
+        munmap(m_map, m_map_size);
+    }
+}
+
+bool FnvDict::open(const std::string& path, std::string& error) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = fmt::format("{}: {}", path, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FnvDictHeader)) {
+        close(fd);
+        error = path + ": not a dictionary file";
+        return false;
+    }
+    void* map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        error = fmt::format("{}: {}", path, strerror(errno));
+        return false;
+    }
+
+    const FnvDictHeader* header = (const FnvDictHeader*)map;
+    // 先用文件大小限制 count 和 strings_size，再计算总大小，避免乘法/加法溢出后恰好等于文件大小
+    const uint64_t body = (uint64_t)st.st_size - sizeof(FnvDictHeader);
+    const bool sizes_ok = header->count < body / sizeof(FnvDictRecord) && header->strings_size <= body &&
+                          sizeof(FnvDictHeader) + (header->count + 1) * sizeof(FnvDictRecord) + header->strings_size ==
+                              (uint64_t)st.st_size;
+    if (memcmp(header->magic, FNV_DICT_MAGIC, sizeof(FNV_DICT_MAGIC)) != 0 ||
+        header->version != FNV_DICT_VERSION || header->layout > FNV_DICT_LAYOUT_EYTZINGER || !sizes_ok) {
+        munmap(map, (size_t)st.st_size);
+        error = path + ": not a dictionary file or unsupported version";
+        return false;
+    }
+    // 每条记录引用的名字都必须在字符串表内，否则损坏或截断的文件会在查找时越界读取
+    const FnvDictRecord* records = (const FnvDictRecord*)((const char*)map + sizeof(FnvDictHeader));
+    for (uint64_t k = 1; k <= header->count; ++k) {
+        if ((uint64_t)records[k].offset + records[k].len > header->strings_size) {
+            munmap(map, (size_t)st.st_size);
+            error = fmt::format("{}: record {} points outside the string table", path, k);
+            return false;
+        }
+    }
+
+    m_map = map;
+    m_map_size = (size_t)st.st_size;
+    m_count = header->count;
+    m_layout = header->layout;
+    m_records = records;
+    m_strings = (const char*)(m_records + m_count + 1);
+    // 查找是随机访问，关闭预读
+    madvise(m_map, m_map_size, MADV_RANDOM);
+    return true;
+}
+
+std::string_view FnvDict::lookup(uint64_t hash) const {
+    size_t k = 0;
+    if (m_layout == FNV_DICT_LAYOUT_EYTZINGER) {
+        k = 1;
+        while (k <= m_count) {
+            __builtin_prefetch(m_records + 4 * k); // 提前取两层之后的 4 个节点
+            k = 2 * k + (m_records[k].hash < hash);
+        }
+        // 去掉最后一段“向右走”的路径，得到第一个 >= hash 的节点
+        k >>= __builtin_ffsll(~(long long)k);
+    } else {
+        const FnvDictRecord* first = m_records + 1;
+        const FnvDictRecord* last = first + m_count;
+        const FnvDictRecord* it = std::lower_bound(first, last, hash, [](const FnvDictRecord& r, uint64_t h) {
+            return r.hash < h;
+        });
+        k = (size_t)(it - m_records);
+    }
+
+    return record_name(k, hash);
+}
+
+void FnvDict::lookup_batch(const uint64_t* hashes, size_t n, std::string_view* out) const {
+    if (m_layout != FNV_DICT_LAYOUT_EYTZINGER) {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = lookup(hashes[i]);
+        }
+        return;
+    }
+
+    const size_t BATCH = 32;
+    size_t k[BATCH];
+    for (size_t base = 0; base < n; base += BATCH) {
+        const size_t m = std::min(BATCH, n - base);
+        for (size_t i = 0; i < m; ++i) {
+            k[i] = 1;
+        }
+        // 每一轮让所有查找各下降一层，同一轮中的内存访问互不依赖
+        bool active = true;
+        while (active) {
+            active = false;
+            for (size_t i = 0; i < m; ++i) {
+                if (k[i] <= m_count) {
+                    __builtin_prefetch(m_records + 4 * k[i]);
+                    k[i] = 2 * k[i] + (m_records[k[i]].hash < hashes[base + i]);
+                    active = true;
+                }
+            }
+        }
+        for (size_t i = 0; i < m; ++i) {
+            size_t r = k[i] >> __builtin_ffsll(~(long long)k[i]);
+            out[base + i] = record_name(r, hashes[base + i]);
+        }
+    }
+}
+
+int run_dict_build(int argc, char* argv[]) {
+    std::string output_file;
+    std::string scan_prefix;
+    bool scan = false;
+    bool eytzinger = true;
+    std::vector<std::string> inputs;
+
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            dict_build_usage();
+            return 0;
+        } else if ((arg == "-o" || arg == "--output") && i + 1 < argc) {
+            output_file = argv[++i];
+        } else if ((arg == "-s" || arg == "--scan") && i + 1 < argc) {
+            scan = true;
+            scan_prefix = argv[++i];
+        } else if (arg == "--sorted") {
+            eytzinger = false;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (inputs.empty() || output_file.empty()) {
+        dict_build_usage();
+        return 1;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::string> all_names;
+    if (!load_names(inputs, scan, scan_prefix, all_names)) {
+        return 1;
+    }
+    UniqueNames unique;
+    unique_names(all_names, !scan, unique);
+    if (unique.collisions > 0) {
+        std::cerr << "Error: " << unique.collisions << " hash collision(s), no dictionary written.\n";
+        return 1;
+    }
+
+    std::string error;
+    if (!write_fnv_dict(output_file, unique, eytzinger, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    std::cerr << fmt::format("dict-build: {} names ({} duplicates), {} layout, {:.3f} s\n",
+                             unique.names.size(), unique.duplicates, eytzinger ? "eytzinger" : "sorted",
+                             std::chrono::duration<double>(t1 - t0).count());
+    return 0;
+}
+
+int run_dict_decode(int argc, char* argv[]) {
+    std::string dict_file;
+    std::vector<std::string> inputs;
+
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            dict_decode_usage();
+            return 0;
+        } else if ((arg == "-d" || arg == "--dict") && i + 1 < argc) {
+            dict_file = argv[++i];
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (dict_file.empty()) {
+        dict_decode_usage();
+        return 1;
+    }
+    if (inputs.empty()) {
+        inputs.push_back("-");
+    }
+
+    FnvDict dict;
+    std::string error;
+    if (!dict.open(dict_file, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    OutputBuffer out(STDOUT_FILENO);
+    DecodeStats stats;
+    int result = 0;
+    for (const auto& input : inputs) {
+        int fd = (input == "-") ? STDIN_FILENO : ::open(input.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0 || !decode_fd(dict, fd, out, stats)) {
+            std::cerr << fmt::format("Error: {}: {}\n", input, strerror(errno));
+            result = 1;
+        }
+        if (fd > STDIN_FILENO) {
+            close(fd);
+        }
+    }
+    out.flush();
+    if (out.failed()) {
+        std::cerr << fmt::format("Error: write failed: {}\n", strerror(errno));
+        return 1;
+    }
+
+    auto t1 = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(t1 - t0).count();
+    double mb = (double)stats.bytes / (1024 * 1024);
+    std::cerr << fmt::format("dict-decode: {:.2f} MB, {} ids ({} unknown), {:.1f} MB/s\n",
+                             mb, stats.ids, stats.unknown, seconds > 0 ? mb / seconds : 0);
+    return result;
+}
@@ -0,0 +1,96 @@
+#ifndef FNV_DICT_H
+#define FNV_DICT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <string_view>
+
+struct UniqueNames;
+
+// 哈希到名字的二进制字典（.fnvd），用于把设备日志中的 fnv1a_64 消息 ID 还原成名字。
+//
+// 文件可以直接 mmap 使用，打开时不需要任何解析。布局（全部为小端）：
+//
+//   FnvDictHeader                      64 字节
+//   FnvDictRecord records[count + 1]   每条 16 字节；records[0] 保留不用，有效记录为 records[1..count]
+//   字符串区 strings_size 字节          每个名字以 '\0' 结尾，record.offset 相对字符串区起点
+//
+// layout 为 FNV_DICT_LAYOUT_SORTED 时 records[1..count] 按 hash 升序排列，使用二分查找；
+// 为 FNV_DICT_LAYOUT_EYTZINGER 时按 Eytzinger（BFS 完全二叉树）顺序排列，records[k] 的
+// 两个子节点是 records[2k] 和 records[2k+1]。因为从下标 1 开始且头部为 64 字节，
+// records[4k..4k+3] 正好落在同一条 cache line 中，查找时可以提前两层预取。
+
+const char FNV_DICT_MAGIC[8] = { 'F', 'N', 'V', 'D', 'I', 'C', 'T', '1' };
+const uint32_t FNV_DICT_VERSION = 1;
+const uint32_t FNV_DICT_LAYOUT_SORTED = 0;
+const uint32_t FNV_DICT_LAYOUT_EYTZINGER = 1;
+
+struct FnvDictHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t layout;
+    uint64_t count;
+    uint64_t strings_size;
+    uint8_t reserved[32];
+};
+static_assert(sizeof(FnvDictHeader) == 64, "FnvDictHeader must be 64 bytes");
+
+struct FnvDictRecord {
+    uint64_t hash;
+    uint32_t offset;
+    uint32_t len;
+};
+static_assert(sizeof(FnvDictRecord) == 16, "FnvDictRecord must be 16 bytes");
+
+/**
+ * @brief 把去重后的名字写成 .fnvd 文件。
+ *
+ * @param names     unique_names() 的结果（按哈希升序）。
+ * @param eytzinger true 使用 Eytzinger 布局，false 使用有序数组布局。
+ */
+bool write_fnv_dict(const std::string& path, const UniqueNames& names, bool eytzinger, std::string& error);
+
+/**
+ * @brief 以只读 mmap 打开的 .fnvd 字典。
+ */
+class FnvDict {
+public:
+    FnvDict() = default;
+    ~FnvDict();
+    FnvDict(const FnvDict&) = delete;
+    FnvDict& operator=(const FnvDict&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+
+    // 查找哈希对应的名字，找不到时返回空的 string_view
+    std::string_view lookup(uint64_t hash) const;
+
+    // 批量查找：多个查找交错推进，让它们的 cache miss 互相重叠；out[i] 对应 hashes[i]
+    void lookup_batch(const uint64_t* hashes, size_t n, std::string_view* out) const;
+
+    uint64_t size() const {
+        return m_count;
+    }
+
+private:
+    std::string_view record_name(size_t k, uint64_t hash) const {
+        if (k == 0 || k > m_count || m_records[k].hash != hash) {
+            return std::string_view();
+        }
+        return std::string_view(m_strings + m_records[k].offset, m_records[k].len);
+    }
+
+    void* m_map = nullptr;
+    size_t m_map_size = 0;
+    const FnvDictRecord* m_records = nullptr;
+    const char* m_strings = nullptr;
+    uint64_t m_count = 0;
+    uint32_t m_layout = FNV_DICT_LAYOUT_SORTED;
+};
+
+// 命令行入口：FNV-1a-64bit dict-build ... / dict-decode ...
+int run_dict_build(int argc, char* argv[]);
+int run_dict_decode(int argc, char* argv[]);
+
+#endif // FNV_DICT_H
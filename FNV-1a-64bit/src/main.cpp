@@ -5,45 +5,273 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <algorithm>
 
-// FNV-1a 算法 64位版本的核心常量
-// FNV-1a 64-bit prime: 1099511628211
-const uint64_t FNV_PRIME_64 = 1099511628211ULL;
-// FNV-1a 64-bit offset basis: 14695981039346656037
-const uint64_t FNV_OFFSET_BASIS_64 = 14695981039346656037ULL;
-
-/**
- * @brief 使用 FNV-1a 算法计算给定数据的64位哈希值。
- * * @param data 指向需要计算哈希值的数据的指针。它可以是任何字节序列。
- * @param len  要计算哈希值的数据长度（以字节为单位）。
- * @return     返回一个64位（8字节）的哈希值。
- *
- * @note 这个函数是线程安全的（只要输入数据不被其他线程修改）。
- * @note 它不分配任何动态内存，非常适合嵌入式系统。
- */
-uint64_t fnv1a_64(const void* data, size_t len) {
-    // 将通用指针转换为字节指针，以便按字节处理
-    const uint8_t* bytes = (const uint8_t*)data;
-
-    // 1. 初始化哈希值为64位的偏移基准值
-    uint64_t hash = FNV_OFFSET_BASIS_64;
-
-    // 2. 遍历数据的每一个字节
-    for (size_t i = 0; i < len; ++i) {
-        // 2a. 先将当前字节与哈希值进行异或(XOR)操作
-        hash ^= (uint64_t)bytes[i];
-        
-        // 2b. 再将结果乘以FNV的64位质数
-        hash *= FNV_PRIME_64;
+#include "fnv1a.h"
+#include "phf.h"
+#include "file_hash.h"
+#include "tree_hash.h"
+#include "string_intern.h"
+#include "fnv_dict.h"
+#include "collision_audit.h"
+
+// 编译期计算的消息 ID 表，static_assert 保证其中没有重复的哈希值
+constexpr uint64_t message_ids[] = {
+    "MSG_MUSIC_BASS_DW"_fnv,
+    "MSG_MUSIC_TREB_DW"_fnv,
+    "MSG_MIC_BASS_DW"_fnv,
+    "MSG_EFFECT_BASS_DW"_fnv,
+    "MSG_MUSIC_EFFECT_DW"_fnv,
+    "MSG_MIC_EFFECT_DW"_fnv,
+};
+static_assert(fnv1a_64_unique(message_ids), "duplicate message id in message_ids");
+
+// 使用 _fnv 字面量的消息分发：case 标签全部在编译期折叠为常量，运行时不再计算哈希
+static const char* dispatch_message(uint64_t id) {
+    switch (id) {
+    case "MSG_MUSIC_BASS_DW"_fnv:   return "music bass";
+    case "MSG_MUSIC_TREB_DW"_fnv:   return "music treble";
+    case "MSG_MIC_BASS_DW"_fnv:     return "mic bass";
+    case "MSG_EFFECT_BASS_DW"_fnv:  return "effect bass";
+    case "MSG_MUSIC_EFFECT_DW"_fnv: return "music effect";
+    case "MSG_MIC_EFFECT_DW"_fnv:   return "mic effect";
+    default:                        return "unknown";
+    }
+}
+
+static void usage() {
+    std::cout << "Usage:\n";
+    std::cout << "  FNV-1a-64bit                      run the demo\n";
+    std::cout << "  FNV-1a-64bit bench-batch [N]      benchmark fnv1a_64_batch with N synthetic keys\n";
+    std::cout << "  FNV-1a-64bit gen-phf ...          generate a perfect hash C header (gen-phf -h for details)\n";
+    std::cout << "  FNV-1a-64bit hash [--tree] [-j N] <file>...\n";
+    std::cout << "                                    hash files through mmap and report MB/s\n";
+    std::cout << "  FNV-1a-64bit bench-tree [MB] [N]  benchmark the tree hash from 1 to N threads\n";
+    std::cout << "  FNV-1a-64bit bench-intern [N]     StringInterner vs std::unordered_map with N identifiers\n";
+    std::cout << "  FNV-1a-64bit dict-build ...       build a mmap-able hash -> name dictionary\n";
+    std::cout << "  FNV-1a-64bit dict-decode ...      replace message IDs in logs with names\n";
+    std::cout << "  FNV-1a-64bit audit ...            report fnv1a_64 collisions in large identifier corpora\n";
+}
+
+// 生成 MSG_*_DW 风格的测试 key
+static std::vector<std::string> make_message_names(size_t count, uint32_t seed) {
+    static const char* parts[] = {
+        "MUSIC", "MIC", "EFFECT", "BASS", "TREB", "MID", "GAIN", "VOL",
+        "ECHO", "REVERB", "EQ", "DRC", "LINE", "USB", "BT", "HFP",
+    };
+    const size_t part_count = sizeof(parts) / sizeof(parts[0]);
+
+    std::mt19937 rng(seed);
+    std::vector<std::string> names;
+    names.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string name = "MSG";
+        size_t words = 2 + rng() % 3;
+        for (size_t w = 0; w < words; ++w) {
+            name += '_';
+            name += parts[rng() % part_count];
+        }
+        name += '_';
+        name += std::to_string(i);
+        name += "_DW";
+        names.push_back(std::move(name));
+    }
+    return names;
+}
+
+// --- 批量哈希基准测试：对比逐个调用 fnv1a_64 与各个批量实现 ---
+static int bench_batch(size_t count) {
+    std::vector<std::string> names = make_message_names(count, 12345);
+    std::vector<std::string_view> keys(names.begin(), names.end());
+
+    std::vector<uint64_t> expected(count);
+    for (size_t i = 0; i < count; ++i) {
+        expected[i] = fnv1a_64(keys[i].data(), keys[i].size());
     }
 
-    // 3. 返回最终计算得到的哈希值
-    return hash;
+    const Fnv1aBatchImpl impls[] = {
+        Fnv1aBatchImpl::Scalar,
+        Fnv1aBatchImpl::Interleaved,
+        Fnv1aBatchImpl::Avx2,
+        Fnv1aBatchImpl::Avx512,
+        Fnv1aBatchImpl::Auto,
+    };
+    const int rounds = 10;
+
+    printf("keys: %zu, rounds: %d\n", count, rounds);
+    double scalar_rate = 0;
+    bool all_ok = true;
+    std::vector<uint64_t> out(count);
+    for (Fnv1aBatchImpl impl : impls) {
+        if (!fnv1a_64_batch_supported(impl)) {
+            printf("%-12s not supported on this CPU\n", fnv1a_64_batch_impl_name(impl));
+            continue;
+        }
+
+        double best = 1e30;
+        for (int r = 0; r < rounds; ++r) {
+            auto t0 = std::chrono::steady_clock::now();
+            fnv1a_64_batch(keys.data(), count, out.data(), impl);
+            auto t1 = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+        }
+
+        bool ok = (out == expected);
+        all_ok = all_ok && ok;
+        double rate = count / best;
+        if (impl == Fnv1aBatchImpl::Scalar) {
+            scalar_rate = rate;
+        }
+        printf("%-12s %10.2f Mkeys/s  x%.2f  %s\n", fnv1a_64_batch_impl_name(impl), rate / 1e6,
+               scalar_rate > 0 ? rate / scalar_rate : 1.0, ok ? "OK" : "MISMATCH");
+    }
+    return all_ok ? 0 : 1;
 }
 
+// --- 树哈希基准测试：单流 fnv1a_64 与 1..N 线程的树哈希对比 ---
+static int bench_tree(size_t mb, unsigned max_threads) {
+    std::vector<uint8_t> data(mb << 20);
+    std::mt19937_64 rng(12345);
+    for (size_t i = 0; i + 8 <= data.size(); i += 8) {
+        uint64_t v = rng();
+        memcpy(&data[i], &v, 8);
+    }
+
+    auto seconds_of = [](auto&& fn) {
+        double best = 1e30;
+        for (int r = 0; r < 3; ++r) {
+            auto t0 = std::chrono::steady_clock::now();
+            fn();
+            auto t1 = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+        }
+        return best;
+    };
+
+    printf("data: %zu MB, chunk: %zu KB\n", mb, FNV_TREE_CHUNK_SIZE >> 10);
+
+    uint64_t stream_hash = 0;
+    double stream = seconds_of([&] { stream_hash = fnv1a_64(data.data(), data.size()); });
+    printf("%-14s %10.1f MB/s  x%.2f  %016llx\n", "single-stream", mb / stream, 1.0, (unsigned long long)stream_hash);
+
+    uint64_t reference = 0;
+    bool all_ok = true;
+    for (unsigned threads = 1; ; threads = std::min(threads * 2, max_threads)) {
+        uint64_t tree_hash = 0;
+        double t = seconds_of([&] { tree_hash = fnv1a_64_tree(data.data(), data.size(), threads); });
+        if (threads == 1) {
+            reference = tree_hash;
+        }
+        // 线程数不同，树哈希的结果必须相同
+        bool ok = (tree_hash == reference);
+        all_ok = all_ok && ok;
+        printf("tree %3u thr   %10.1f MB/s  x%.2f  %016llx %s\n", threads, mb / t, stream / t,
+               (unsigned long long)tree_hash, ok ? "OK" : "MISMATCH");
+        if (threads == max_threads) {
+            break;
+        }
+    }
+    return all_ok ? 0 : 1;
+}
+
+// --- 字符串驻留表基准测试：StringInterner 与 std::unordered_map<std::string, uint32_t> 对比 ---
+static int bench_intern(size_t count) {
+    std::vector<std::string> names = make_message_names(count, 777);
+    // 查找顺序打乱，避免顺序访问掩盖缓存未命中
+    std::vector<std::string> queries = names;
+    std::shuffle(queries.begin(), queries.end(), std::mt19937(42));
+
+    auto seconds_since = [](std::chrono::steady_clock::time_point t0) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    };
+
+    // std::unordered_map：插入时分配节点并拷贝字符串，查找时先哈希再比较字符串
+    auto t0 = std::chrono::steady_clock::now();
+    std::unordered_map<std::string, uint32_t> map;
+    for (const auto& name : names) {
+        map.emplace(name, (uint32_t)map.size());
+    }
+    double map_insert = seconds_since(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    uint64_t map_sum = 0;
+    for (const auto& q : queries) {
+        map_sum += map.find(q)->second;
+    }
+    double map_lookup = seconds_since(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    StringInterner interner;
+    for (const auto& name : names) {
+        interner.intern(name);
+    }
+    double intern_insert = seconds_since(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    uint64_t intern_sum = 0;
+    for (const auto& q : queries) {
+        intern_sum += interner.find(q);
+    }
+    double intern_lookup = seconds_since(t0);
+
+    // 调用方已经持有 fnv1a_64 值（例如设备日志中的消息 ID）时，查找不再需要计算哈希
+    std::vector<std::string_view> query_views(queries.begin(), queries.end());
+    std::vector<uint64_t> query_hashes(count);
+    fnv1a_64_batch(query_views.data(), count, query_hashes.data());
+    t0 = std::chrono::steady_clock::now();
+    uint64_t prehashed_sum = 0;
+    for (size_t i = 0; i < count; ++i) {
+        prehashed_sum += interner.find(query_views[i], query_hashes[i]);
+    }
+    double prehashed_lookup = seconds_since(t0);
+
+    // 两者都按插入顺序编号，查找结果的和必须相同
+    bool ok = (map_sum == intern_sum) && (map_sum == prehashed_sum) && (interner.size() == map.size());
+    printf("identifiers: %zu (unique %zu)\n", count, interner.size());
+    printf("%-20s insert %8.2f Mops/s   lookup %8.2f Mops/s\n", "unordered_map",
+           count / map_insert / 1e6, count / map_lookup / 1e6);
+    printf("%-20s insert %8.2f Mops/s   lookup %8.2f Mops/s   %s\n", "StringInterner",
+           count / intern_insert / 1e6, count / intern_lookup / 1e6, ok ? "OK" : "MISMATCH");
+    printf("%-20s                        lookup %8.2f Mops/s\n", "  (pre-hashed)", count / prehashed_lookup / 1e6);
+    return ok ? 0 : 1;
+}
 
 // --- main 函数用于演示和测试 ---
-int main() {
+int main(int argc, char* argv[]) {
+
+    if (argc > 1) {
+        std::string cmd = argv[1];
+        if (cmd == "-h" || cmd == "--help") {
+            usage();
+            return 0;
+        } else if (cmd == "bench-batch") {
+            size_t count = (argc > 2) ? std::stoul(argv[2]) : 500000;
+            return bench_batch(count);
+        } else if (cmd == "gen-phf") {
+            return run_gen_phf(argc - 2, argv + 2);
+        } else if (cmd == "hash") {
+            return run_hash_files(argc - 2, argv + 2);
+        } else if (cmd == "bench-tree") {
+            size_t mb = (argc > 2) ? std::stoul(argv[2]) : 512;
+            unsigned max_threads = (argc > 3) ? (unsigned)std::stoul(argv[3]) : std::thread::hardware_concurrency();
+            return bench_tree(mb, std::max(1u, max_threads));
+        } else if (cmd == "bench-intern") {
+            size_t count = (argc > 2) ? std::stoul(argv[2]) : 1000000;
+            return bench_intern(count);
+        } else if (cmd == "dict-build") {
+            return run_dict_build(argc - 2, argv + 2);
+        } else if (cmd == "dict-decode") {
+            return run_dict_decode(argc - 2, argv + 2);
+        } else if (cmd == "audit") {
+            return run_audit(argc - 2, argv + 2);
+        }
+        usage();
+        return 1;
+    }
 
     std::vector<std::string> strs = {
         "MSG_MUSIC_BASS_DW",
@@ -57,7 +285,8 @@ int main() {
     };
 
     for (const auto& str : strs) {
-        std::cout << "str: " << str << ", fnv1a_64: " << fnv1a_64(str.c_str(), strlen(str.c_str())) << std::endl;
+        uint64_t id = fnv1a_64(str.c_str(), strlen(str.c_str()));
+        std::cout << "str: " << str << ", fnv1a_64: " << id << ", dispatch: " << dispatch_message(id) << std::endl;
     }
 
     return 0;
@@ -0,0 +1,74 @@
+#include "name_list.h"
+#include "fnv1a.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string_view>
+#include <fmt/format.h>
+
+namespace {
+
+bool read_file(const std::string& path, std::string& content) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::ostringstream ss;
+    ss << file.rdbuf();
+    content = ss.str();
+    return true;
+}
+
+} // namespace
+
+bool load_names(const std::vector<std::string>& inputs, bool scan, const std::string& prefix,
+                std::vector<std::string>& names) {
+    for (const auto& input : inputs) {
+        std::string content;
+        if (!read_file(input, content)) {
+            std::cerr << "Error: cannot open " << input << "\n";
+            return false;
+        }
+        for_each_name(content.data(), content.size(), scan, prefix, [&](size_t offset, size_t len) {
+            names.emplace_back(content, offset, len);
+        });
+    }
+    return true;
+}
+
+void unique_names(const std::vector<std::string>& names, bool warn_duplicates, UniqueNames& out) {
+    std::vector<std::string_view> views(names.begin(), names.end());
+    std::vector<uint64_t> hashes(views.size());
+    fnv1a_64_batch(views.data(), views.size(), hashes.data());
+
+    // 按 (hash, name) 排序：相同名字相邻出现即为重复，相同哈希不同名字即为64位碰撞
+    std::vector<uint32_t> order(views.size());
+    for (uint32_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        if (hashes[a] != hashes[b]) return hashes[a] < hashes[b];
+        return views[a] < views[b];
+    });
+
+    out = UniqueNames();
+    for (uint32_t i : order) {
+        if (!out.hashes.empty() && out.hashes.back() == hashes[i]) {
+            if (out.names.back() == views[i]) {
+                if (warn_duplicates) {
+                    std::cerr << "Warning: duplicate name " << views[i] << " ignored\n";
+                }
+                out.duplicates++;
+            } else {
+                std::cerr << fmt::format("Error: fnv1a_64 collision 0x{:016X}: {} vs {}\n",
+                                         hashes[i], out.names.back(), views[i]);
+                out.collisions++;
+            }
+            continue;
+        }
+        out.names.emplace_back(views[i]);
+        out.hashes.push_back(hashes[i]);
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef NAME_LIST_H
+#define NAME_LIST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// gen-phf、dict-build 等模式共用的名字输入处理
+
+inline bool is_c_ident_start(char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
+}
+
+inline bool is_c_ident_char(char c) {
+    return is_c_ident_start(c) || (c >= '0' && c <= '9');
+}
+
+/**
+ * @brief 不复制地遍历一段文本中的名字，规则与 load_names() 相同。
+ *
+ * @param scan   false：每行一个名字（去掉首尾空白，忽略空行和 # 注释行）；
+ *               true：收集以 prefix 开头且比 prefix 长的 C 标识符。
+ * @param f      对每个名字调用 f(offset, length)，offset 相对 data 起点。
+ */
+template <typename F>
+void for_each_name(const char* data, size_t len, bool scan, const std::string& prefix, F&& f) {
+    size_t i = 0;
+    if (scan) {
+        while (i < len) {
+            if (!is_c_ident_start(data[i])) {
+                ++i;
+                continue;
+            }
+            size_t start = i;
+            while (i < len && is_c_ident_char(data[i])) {
+                ++i;
+            }
+            if (i - start > prefix.size() && prefix.compare(0, prefix.size(), data + start, prefix.size()) == 0) {
+                f(start, i - start);
+            }
+        }
+        return;
+    }
+
+    auto is_space = [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; };
+    while (i < len) {
+        size_t line_end = i;
+        while (line_end < len && data[line_end] != '\n') {
+            ++line_end;
+        }
+        size_t first = i;
+        while (first < line_end && is_space(data[first])) {
+            ++first;
+        }
+        size_t last = line_end;
+        while (last > first && is_space(data[last - 1])) {
+            --last;
+        }
+        if (first < last && data[first] != '#') {
+            f(first, last - first);
+        }
+        i = line_end + 1;
+    }
+}
+
+/**
+ * @brief 返回从 offset 开始的名字的长度，offset 必须是 for_each_name() 报告过的位置。
+ */
+inline size_t name_length_at(const char* data, size_t len, size_t offset, bool scan) {
+    size_t end = offset;
+    if (scan) {
+        while (end < len && is_c_ident_char(data[end])) {
+            ++end;
+        }
+        return end - offset;
+    }
+    while (end < len && data[end] != '\n') {
+        ++end;
+    }
+    while (end > offset && (data[end - 1] == ' ' || data[end - 1] == '\t' || data[end - 1] == '\r')) {
+        --end;
+    }
+    return end - offset;
+}
+
+/**
+ * @brief 从输入文件中读取名字。
+ *
+ * @param inputs 输入文件列表。
+ * @param scan   false：每行一个名字，忽略空行和 # 开头的注释行；
+ *               true：把输入当作 C 源码，收集以 prefix 开头的标识符。
+ * @param prefix scan 为 true 时的标识符前缀，例如 "MSG_"。
+ * @param names  读到的名字追加到这里（可能有重复）。
+ * @return       所有文件都读取成功返回 true，否则向 stderr 报错并返回 false。
+ */
+bool load_names(const std::vector<std::string>& inputs, bool scan, const std::string& prefix,
+                std::vector<std::string>& names);
+
+struct UniqueNames {
+    std::vector<std::string> names; // 按 hashes 升序排列
+    std::vector<uint64_t> hashes;   // names[i] 的 fnv1a_64
+    size_t duplicates = 0;          // 被忽略的重复名字个数
+    size_t collisions = 0;          // 哈希相同但名字不同的个数
+};
+
+/**
+ * @brief 计算所有名字的 fnv1a_64，去掉重复的名字并检查64位碰撞。
+ *
+ * 碰撞会逐条打印到 stderr，调用者应检查 out.collisions 决定是否继续。
+ *
+ * @param warn_duplicates 为 true 时把每个重复的名字打印到 stderr。
+ */
+void unique_names(const std::vector<std::string>& names, bool warn_duplicates, UniqueNames& out);
+
+#endif // NAME_LIST_H
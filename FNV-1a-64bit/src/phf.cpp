@@ -0,0 +1,323 @@
+#include "phf.h"
+#include "fnv1a.h"
+#include "name_list.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <fmt/format.h>
+
+namespace {
+
+// 单个种子下 pilot 搜索的上限，超过后换一个种子重来
+const uint32_t PHF_MAX_PILOT = 1u << 24;
+const int PHF_MAX_SEEDS = 16;
+
+bool build_with_seed(const std::vector<uint64_t>& hashes, uint64_t seed, PerfectHash& out) {
+    const uint32_t n = (uint32_t)hashes.size();
+    const uint32_t bucket_count = std::max<uint32_t>(1, (n + PHF_KEYS_PER_BUCKET - 1) / PHF_KEYS_PER_BUCKET);
+    const uint32_t table_size = (uint32_t)(((uint64_t)n * 100 + PHF_LOAD_PERCENT - 1) / PHF_LOAD_PERCENT);
+
+    // 按桶计数排序，得到每个桶内的 key 下标
+    std::vector<uint32_t> bucket_start(bucket_count + 1, 0);
+    for (uint64_t h : hashes) {
+        bucket_start[phf_bucket(h, bucket_count) + 1]++;
+    }
+    for (uint32_t b = 0; b < bucket_count; ++b) {
+        bucket_start[b + 1] += bucket_start[b];
+    }
+    std::vector<uint32_t> bucket_keys(n);
+    {
+        std::vector<uint32_t> fill(bucket_start.begin(), bucket_start.end() - 1);
+        for (uint32_t i = 0; i < n; ++i) {
+            bucket_keys[fill[phf_bucket(hashes[i], bucket_count)]++] = i;
+        }
+    }
+
+    // 大桶优先：表越空越容易为大桶找到 pilot
+    std::vector<uint32_t> order(bucket_count);
+    for (uint32_t b = 0; b < bucket_count; ++b) {
+        order[b] = b;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return bucket_start[a + 1] - bucket_start[a] > bucket_start[b + 1] - bucket_start[b];
+    });
+
+    std::vector<uint8_t> taken(table_size, 0);
+    std::vector<uint32_t> slots;
+    out.seed = seed;
+    out.bucket_count = bucket_count;
+    out.table_size = table_size;
+    out.max_pilot = 0;
+    out.pilots.assign(bucket_count, 0);
+    out.slot_of_key.assign(n, 0);
+
+    for (uint32_t b : order) {
+        const uint32_t begin = bucket_start[b];
+        const uint32_t size = bucket_start[b + 1] - begin;
+        if (size == 0) {
+            break; // 之后都是空桶，pilot 保持 0
+        }
+
+        uint32_t pilot = 0;
+        for (; pilot < PHF_MAX_PILOT; ++pilot) {
+            slots.clear();
+            bool ok = true;
+            for (uint32_t k = 0; k < size && ok; ++k) {
+                uint32_t slot = phf_slot(hashes[bucket_keys[begin + k]], seed, pilot, table_size);
+                if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                    ok = false;
+                }
+                slots.push_back(slot);
+            }
+            if (ok) {
+                break;
+            }
+        }
+        if (pilot == PHF_MAX_PILOT) {
+            return false;
+        }
+
+        out.pilots[b] = pilot;
+        out.max_pilot = std::max(out.max_pilot, pilot);
+        for (uint32_t k = 0; k < size; ++k) {
+            taken[slots[k]] = 1;
+            out.slot_of_key[bucket_keys[begin + k]] = slots[k];
+        }
+    }
+
+    // 把落在 [n, table_size) 的 key 搬到 [0, n) 的空位上
+    out.remap.assign(table_size - n, 0);
+    uint32_t free_slot = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t slot = out.slot_of_key[i];
+        if (slot < n) {
+            continue;
+        }
+        while (taken[free_slot]) {
+            ++free_slot;
+        }
+        taken[free_slot] = 1;
+        out.remap[slot - n] = free_slot;
+        out.slot_of_key[i] = free_slot;
+    }
+    return true;
+}
+
+std::string to_upper_ident(const std::string& s) {
+    std::string r;
+    for (char c : s) {
+        r += is_c_ident_char(c) ? (char)toupper((unsigned char)c) : '_';
+    }
+    return r;
+}
+
+std::string c_escape(const std::string& s) {
+    std::string r;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            r += '\\';
+        }
+        r += c;
+    }
+    return r;
+}
+
+// 能容纳 max_value 的最小无符号类型
+const char* c_uint_type(uint32_t max_value) {
+    if (max_value <= 0xFF) return "uint8_t";
+    if (max_value <= 0xFFFF) return "uint16_t";
+    return "uint32_t";
+}
+
+// 表名直接拼进生成的 C 代码 (宏、数组和函数名)，必须是合法的 C 标识符
+bool is_identifier(const std::string& name) {
+    if (name.empty() || isdigit((unsigned char)name[0])) {
+        return false;
+    }
+    for (char c : name) {
+        if (!isalnum((unsigned char)c) && c != '_') {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string emit_header(const std::string& name, const std::vector<std::string>& names,
+                        const std::vector<uint64_t>& hashes, const PerfectHash& phf, bool with_names) {
+    const uint32_t n = (uint32_t)names.size();
+    const std::string upper = to_upper_ident(name);
+
+    std::vector<uint32_t> key_of_slot(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        key_of_slot[phf.slot_of_key[i]] = i;
+    }
+
+    std::string out;
+    out += fmt::format("/* Automatically generated by FNV-1a-64bit gen-phf, do not edit. */\n");
+    out += fmt::format("/* {} names, {} buckets, minimal perfect hash over fnv1a_64. */\n\n", n, phf.bucket_count);
+    out += fmt::format("#ifndef __{}_H__\n#define __{}_H__\n\n#include <stdint.h>\n\n", upper, upper);
+    out += fmt::format("#define {}_COUNT   {}u\n", upper, n);
+    out += fmt::format("#define {}_BUCKETS {}u\n", upper, phf.bucket_count);
+    out += fmt::format("#define {}_TABLE   {}u\n", upper, phf.table_size);
+    out += fmt::format("#define {}_SEED    0x{:016X}ULL\n\n", upper, phf.seed);
+
+    out += fmt::format("static const {} {}_pilots[{}_BUCKETS] = {{", c_uint_type(phf.max_pilot), name, upper);
+    for (uint32_t b = 0; b < phf.bucket_count; ++b) {
+        out += fmt::format("{}{},", (b % 16 == 0) ? "\n\t" : " ", phf.pilots[b]);
+    }
+    out += "\n};\n\n";
+
+    // 空数组在 C 中不合法，至少保留一个元素
+    out += fmt::format("/* slot {}_COUNT + i is stored at slot {}_remap[i] */\n", upper, name);
+    out += fmt::format("static const {} {}_remap[{}] = {{", c_uint_type(n), name, std::max<size_t>(1, phf.remap.size()));
+    for (size_t i = 0; i < phf.remap.size(); ++i) {
+        out += fmt::format("{}{},", (i % 16 == 0) ? "\n\t" : " ", phf.remap[i]);
+    }
+    out += phf.remap.empty() ? "\n\t0,\n};\n\n" : "\n};\n\n";
+
+    out += fmt::format("/* fnv1a_64 of each name, indexed by slot */\n");
+    out += fmt::format("static const uint64_t {}_hashes[{}_COUNT] = {{\n", name, upper);
+    for (uint32_t s = 0; s < n; ++s) {
+        out += fmt::format("\t0x{:016X}ULL, /* {} */\n", hashes[key_of_slot[s]], names[key_of_slot[s]]);
+    }
+    out += "};\n\n";
+
+    if (with_names) {
+        out += fmt::format("static const char* const {}_names[{}_COUNT] = {{\n", name, upper);
+        for (uint32_t s = 0; s < n; ++s) {
+            out += fmt::format("\t\"{}\",\n", c_escape(names[key_of_slot[s]]));
+        }
+        out += "};\n\n";
+    }
+
+    out += fmt::format(R"(static inline uint32_t {0}_slot(uint64_t hash)
+{{
+	uint32_t bucket = (uint32_t)(((hash >> 32) * {1}_BUCKETS) >> 32);
+	uint64_t x = hash ^ {1}_SEED ^ ((uint64_t){0}_pilots[bucket] * 0x9E3779B97F4A7C15ULL);
+	x ^= x >> 32;
+	x *= 0xD6E8FEB86659FD93ULL;
+	x ^= x >> 32;
+	uint32_t slot = (uint32_t)(((x & 0xFFFFFFFFULL) * {1}_TABLE) >> 32);
+	return (slot < {1}_COUNT) ? slot : {0}_remap[slot - {1}_COUNT];
+}}
+
+/* Returns the slot of a fnv1a_64 message id, or -1 if the id is unknown. */
+static inline int32_t {0}_lookup(uint64_t hash)
+{{
+	uint32_t slot = {0}_slot(hash);
+	return ({0}_hashes[slot] == hash) ? (int32_t)slot : -1;
+}}
+
+#endif/*__{1}_H__*/
+)", name, upper);
+    return out;
+}
+
+void gen_phf_usage() {
+    std::cout << "Usage: FNV-1a-64bit gen-phf [options] <input>...\n";
+    std::cout << "  -o, --output FILE    write the C header to FILE (default: stdout)\n";
+    std::cout << "  -n, --name NAME      symbol prefix of the generated table (default: msg_phf)\n";
+    std::cout << "  -s, --scan PREFIX    scan inputs as C sources for identifiers starting with PREFIX\n";
+    std::cout << "                       (default: inputs are name lists, one name per line)\n";
+    std::cout << "      --no-names       do not emit the name string table\n";
+}
+
+} // namespace
+
+bool build_perfect_hash(const std::vector<uint64_t>& hashes, PerfectHash& out) {
+    uint64_t seed = 0;
+    for (int attempt = 0; attempt < PHF_MAX_SEEDS; ++attempt) {
+        if (build_with_seed(hashes, seed, out)) {
+            return true;
+        }
+        seed = fnv1a_64(&seed, sizeof(seed));
+    }
+    return false;
+}
+
+int run_gen_phf(int argc, char* argv[]) {
+    std::string output_file;
+    std::string table_name = "msg_phf";
+    std::string scan_prefix;
+    bool scan = false;
+    bool with_names = true;
+    std::vector<std::string> inputs;
+
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            gen_phf_usage();
+            return 0;
+        } else if ((arg == "-o" || arg == "--output") && i + 1 < argc) {
+            output_file = argv[++i];
+        } else if ((arg == "-n" || arg == "--name") && i + 1 < argc) {
+            table_name = argv[++i];
+        } else if ((arg == "-s" || arg == "--scan") && i + 1 < argc) {
+            scan = true;
+            scan_prefix = argv[++i];
+        } else if (arg == "--no-names") {
+            with_names = false;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (inputs.empty()) {
+        gen_phf_usage();
+        return 1;
+    }
+    if (!is_identifier(table_name)) {
+        std::cerr << "Error: " << table_name << " is not a C identifier.\n";
+        return 1;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::vector<std::string> all_names;
+    if (!load_names(inputs, scan, scan_prefix, all_names)) {
+        return 1;
+    }
+
+    // 扫描头文件时同一个宏名出现多次是正常的，只有名字列表中的重复才需要警告
+    UniqueNames unique;
+    unique_names(all_names, !scan, unique);
+    if (unique.collisions > 0) {
+        std::cerr << "Error: " << unique.collisions << " hash collision(s), no table generated.\n";
+        return 1;
+    }
+    if (unique.names.empty()) {
+        std::cerr << "Error: no names found.\n";
+        return 1;
+    }
+    const std::vector<std::string>& names = unique.names;
+    const std::vector<uint64_t>& hashes = unique.hashes;
+
+    PerfectHash phf;
+    if (!build_perfect_hash(hashes, phf)) {
+        std::cerr << "Error: failed to build the perfect hash table.\n";
+        return 1;
+    }
+
+    std::string header = emit_header(table_name, names, hashes, phf, with_names);
+    if (output_file.empty()) {
+        std::cout << header;
+    } else {
+        std::ofstream out(output_file, std::ios::binary);
+        if (!out.is_open()) {
+            std::cerr << "Error: cannot open " << output_file << " for writing.\n";
+            return 1;
+        }
+        out << header;
+    }
+
+    auto t1 = std::chrono::steady_clock::now();
+    std::cerr << fmt::format("gen-phf: {} names ({} duplicates), {} buckets, {} remapped, max pilot {}, {:.3f} s\n",
+                             names.size(), unique.duplicates, phf.bucket_count, phf.remap.size(), phf.max_pilot,
+                             std::chrono::duration<double>(t1 - t0).count());
+    return 0;
+}
@@ -0,0 +1,57 @@
+#ifndef PHF_H
+#define PHF_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// 基于 FNV-1a 64位哈希值的最小完美哈希（hash-and-displace / CHD 变体）。
+//
+// n 个互不相同的哈希值被分到 bucket_count 个桶中，每个桶有一个 pilot（位移值），
+// 使得 phf_slot(h, pilots[phf_bucket(h)]) 把 n 个哈希值一一映射到 [0, table_size)。
+// table_size 略大于 n（负载因子 PHF_LOAD_PERCENT%），落在 [n, table_size) 的少数 key
+// 通过 remap 表搬到 [0, n) 中的空位，从而保持“最小”，同时避免满载时 pilot 搜索急剧变慢。
+// 查找只需读一个 pilot 和一个表项（极少数情况下再读一次 remap），与 key 的个数无关。
+//
+// 下面的两个函数会被原样输出到生成的 C 头文件中，修改时必须保持两边一致。
+
+// 平均每个桶的 key 数，越大 pilot 表越小，但构建越慢
+const uint32_t PHF_KEYS_PER_BUCKET = 4;
+// 构建时的负载因子（百分比）
+const uint32_t PHF_LOAD_PERCENT = 99;
+
+inline uint32_t phf_bucket(uint64_t hash, uint32_t bucket_count) {
+    return (uint32_t)(((hash >> 32) * bucket_count) >> 32);
+}
+
+inline uint32_t phf_slot(uint64_t hash, uint64_t seed, uint32_t pilot, uint32_t table_size) {
+    uint64_t x = hash ^ seed ^ ((uint64_t)pilot * 0x9E3779B97F4A7C15ULL);
+    x ^= x >> 32;
+    x *= 0xD6E8FEB86659FD93ULL;
+    x ^= x >> 32;
+    return (uint32_t)(((x & 0xFFFFFFFFULL) * table_size) >> 32);
+}
+
+struct PerfectHash {
+    uint64_t seed = 0;
+    uint32_t bucket_count = 0;
+    uint32_t table_size = 0;
+    uint32_t max_pilot = 0;
+    std::vector<uint32_t> pilots;      // 每个桶的 pilot
+    std::vector<uint32_t> remap;       // 槽位 n + i 实际对应的槽位 remap[i]
+    std::vector<uint32_t> slot_of_key; // 第 i 个输入哈希值最终所在的槽位（< n）
+};
+
+/**
+ * @brief 为一组互不相同的64位哈希值构建最小完美哈希。
+ *
+ * @param hashes 输入的哈希值，调用者必须保证没有重复。
+ * @param out    构建结果。
+ * @return       成功返回 true；在多个种子下都找不到 pilot 时返回 false。
+ */
+bool build_perfect_hash(const std::vector<uint64_t>& hashes, PerfectHash& out);
+
+// 命令行入口：FNV-1a-64bit gen-phf ...
+int run_gen_phf(int argc, char* argv[]);
+
+#endif // PHF_H
@@ -0,0 +1,100 @@
+#include "string_intern.h"
+#include "fnv1a.h"
+
+#include <string.h>
+#include <algorithm>
+
+StringInterner::StringInterner(size_t expected_count) {
+    reserve(std::max<size_t>(expected_count, 16));
+}
+
+void StringInterner::reserve(size_t count) {
+    // 负载因子不超过 1/2，线性探测的未命中查找仍然很短
+    size_t capacity = 16;
+    while (capacity < count * 2) {
+        capacity *= 2;
+    }
+    if (capacity > m_slots.size()) {
+        rehash(capacity);
+    }
+    m_entries.reserve(count);
+}
+
+void StringInterner::rehash(size_t capacity) {
+    std::vector<Slot> slots(capacity, Slot{0, nullptr, 0, INVALID_HANDLE});
+    unsigned shift = 64;
+    for (size_t c = capacity; c > 1; c >>= 1) {
+        --shift;
+    }
+
+    const size_t mask = capacity - 1;
+    for (const Slot& s : m_slots) {
+        if (s.handle == INVALID_HANDLE) {
+            continue;
+        }
+        size_t i = (size_t)(s.hash >> shift);
+        while (slots[i].handle != INVALID_HANDLE) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = s;
+    }
+
+    m_slots.swap(slots);
+    m_shift = shift;
+}
+
+const char* StringInterner::store(std::string_view str) {
+    if (str.size() > m_block_left) {
+        size_t block_size = std::max(ARENA_BLOCK_SIZE, str.size());
+        m_blocks.emplace_back(new char[block_size]);
+        m_block_pos = m_blocks.back().get();
+        m_block_left = block_size;
+    }
+    char* dst = m_block_pos;
+    memcpy(dst, str.data(), str.size());
+    m_block_pos += str.size();
+    m_block_left -= str.size();
+    return dst;
+}
+
+uint32_t StringInterner::find(std::string_view str, uint64_t hash) const {
+    const size_t mask = m_slots.size() - 1;
+    for (size_t i = probe_start(hash); ; i = (i + 1) & mask) {
+        const Slot& s = m_slots[i];
+        if (s.handle == INVALID_HANDLE) {
+            return INVALID_HANDLE;
+        }
+        if (s.hash == hash && std::string_view(s.data, s.len) == str) {
+            return s.handle;
+        }
+    }
+}
+
+uint32_t StringInterner::find(std::string_view str) const {
+    return find(str, fnv1a_64(str.data(), str.size()));
+}
+
+uint32_t StringInterner::intern(std::string_view str, uint64_t hash) {
+    if ((m_entries.size() + 1) * 2 > m_slots.size()) {
+        rehash(m_slots.size() * 2);
+    }
+
+    const size_t mask = m_slots.size() - 1;
+    size_t i = probe_start(hash);
+    for (; m_slots[i].handle != INVALID_HANDLE; i = (i + 1) & mask) {
+        const Slot& s = m_slots[i];
+        if (s.hash == hash && std::string_view(s.data, s.len) == str) {
+            return s.handle;
+        }
+    }
+
+    uint32_t handle = (uint32_t)m_entries.size();
+    const char* data = store(str);
+    m_entries.push_back(Entry{data, hash, (uint32_t)str.size()});
+    m_slots[i] = Slot{hash, data, (uint32_t)str.size(), handle};
+    return handle;
+}
+
+uint32_t StringInterner::intern(std::string_view str) {
+    return intern(str, fnv1a_64(str.data(), str.size()));
+}
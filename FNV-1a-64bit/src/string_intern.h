@@ -0,0 +1,86 @@
+#ifndef STRING_INTERN_H
+#define STRING_INTERN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief 以 fnv1a_64 为键的字符串驻留表（string interning）。
+ *
+ * - 扁平的开放寻址哈希表（线性探测），每个槽位保存完整的64位哈希值和句柄，
+ *   只有哈希值完全相同时才会去比较字符串内容；
+ * - 字符串内容按块存放在内部的 arena 中，插入后地址不再变化；
+ * - 每个不同的字符串分配一个从 0 开始递增的整数句柄，句柄在表的生命周期内保持稳定，
+ *   可以直接用作数组下标。
+ *
+ * @note 不是线程安全的；多线程只读（find/str）是安全的。
+ */
+class StringInterner {
+public:
+    static constexpr uint32_t INVALID_HANDLE = 0xFFFFFFFFu;
+
+    explicit StringInterner(size_t expected_count = 0);
+
+    // 返回字符串的句柄，不存在时插入
+    uint32_t intern(std::string_view str);
+    // 调用者已经算好 fnv1a_64(str) 时使用，避免重复计算哈希
+    uint32_t intern(std::string_view str, uint64_t hash);
+
+    // 查找字符串的句柄，不存在时返回 INVALID_HANDLE
+    uint32_t find(std::string_view str) const;
+    uint32_t find(std::string_view str, uint64_t hash) const;
+
+    // 句柄对应的字符串，返回的 string_view 在表的生命周期内有效
+    std::string_view str(uint32_t handle) const {
+        const Entry& e = m_entries[handle];
+        return std::string_view(e.data, e.len);
+    }
+
+    uint64_t hash(uint32_t handle) const {
+        return m_entries[handle].hash;
+    }
+
+    size_t size() const {
+        return m_entries.size();
+    }
+
+    void reserve(size_t count);
+
+private:
+    // 槽位里直接放字符串的地址和长度，命中时不必再访问 m_entries
+    struct Slot {
+        uint64_t hash;
+        const char* data;
+        uint32_t len;
+        uint32_t handle; // INVALID_HANDLE 表示空槽
+    };
+
+    struct Entry {
+        const char* data;
+        uint64_t hash;
+        uint32_t len;
+    };
+
+    // arena 的块大小；超过块大小的字符串单独分配一块
+    static constexpr size_t ARENA_BLOCK_SIZE = 64 * 1024;
+
+    std::vector<Slot> m_slots;
+    std::vector<Entry> m_entries;
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    char* m_block_pos = nullptr;
+    size_t m_block_left = 0;
+    unsigned m_shift = 64;
+
+    size_t probe_start(uint64_t hash) const {
+        // FNV-1a 的高位混合得比低位充分，用高位作为起始槽位
+        return (size_t)(hash >> m_shift);
+    }
+
+    const char* store(std::string_view str);
+    void rehash(size_t capacity);
+};
+
+#endif // STRING_INTERN_H
@@ -0,0 +1,55 @@
+#include "tree_hash.h"
+#include "fnv1a.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+uint64_t fnv1a_64_tree_combine(const uint64_t* digests, size_t count, uint64_t total_len) {
+    Fnv1a64 root;
+    uint8_t le[8];
+    for (int b = 0; b < 8; ++b) {
+        le[b] = (uint8_t)(total_len >> (8 * b));
+    }
+    root.update(le, sizeof(le));
+    for (size_t i = 0; i < count; ++i) {
+        for (int b = 0; b < 8; ++b) {
+            le[b] = (uint8_t)(digests[i] >> (8 * b));
+        }
+        root.update(le, sizeof(le));
+    }
+    return root.finalize();
+}
+
+uint64_t fnv1a_64_tree(const void* data, size_t len, unsigned threads) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    const size_t chunks = (len + FNV_TREE_CHUNK_SIZE - 1) / FNV_TREE_CHUNK_SIZE;
+    std::vector<uint64_t> digests(chunks);
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = (unsigned)std::min<size_t>(threads, std::max<size_t>(1, chunks));
+
+    // 各线程从共享计数器领取下一个块，块按顺序被领取，对 mmap 的预读也友好
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < chunks; i = next++) {
+            size_t offset = i * FNV_TREE_CHUNK_SIZE;
+            size_t size = std::min(FNV_TREE_CHUNK_SIZE, len - offset);
+            digests[i] = fnv1a_64(bytes + offset, size);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker(); // 当前线程也参与计算
+    for (auto& th : pool) {
+        th.join();
+    }
+
+    return fnv1a_64_tree_combine(digests.data(), chunks, len);
+}
@@ -0,0 +1,38 @@
+#ifndef TREE_HASH_H
+#define TREE_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// FNV-1a 分块树哈希（FNV tree hash）
+//
+// 普通的 FNV-1a 是严格串行的，一个大文件只能用一个核心。树哈希把输入切成固定大小的块，
+// 各块可以并行计算，再把块摘要合并成根哈希。为保证结果可复现，格式固定如下：
+//
+//   1. 块大小固定为 FNV_TREE_CHUNK_SIZE（1 MiB），最后一块可以不足 1 MiB；
+//      长度为 0 的输入没有块。
+//   2. 第 i 块的摘要 c_i = fnv1a_64(chunk_i)。
+//   3. 根哈希 = fnv1a_64( LE64(total_len) || LE64(c_0) || LE64(c_1) || ... || LE64(c_{k-1}) )，
+//      其中 LE64 表示 8 字节小端编码，total_len 为输入的总字节数。
+//
+// 树哈希与 fnv1a_64 的结果不同，两者不能混用比较。
+
+const size_t FNV_TREE_CHUNK_SIZE = 1 << 20;
+
+/**
+ * @brief 按上面的规则合并块摘要，得到根哈希。
+ *
+ * @param digests   各块的摘要，按块的顺序排列。
+ * @param count     块的个数。
+ * @param total_len 输入的总字节数。
+ */
+uint64_t fnv1a_64_tree_combine(const uint64_t* digests, size_t count, uint64_t total_len);
+
+/**
+ * @brief 使用 threads 个线程计算内存中数据的树哈希。
+ *
+ * @param threads 线程数，0 表示使用全部硬件线程。
+ */
+uint64_t fnv1a_64_tree(const void* data, size_t len, unsigned threads);
+
+#endif // TREE_HASH_H
@@ -0,0 +1,381 @@
+#include "ksa_analysis.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "ksa_batch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KSA_HAVE_X86 1
+#endif
+
+namespace {
+
+// (-1)^(popcount(y & b)): entry (y, b) of the 256x256 Hadamard matrix
+inline int hadamard_sign(int y, int b) {
+  return 1 - 2 * __builtin_parity((unsigned)(y & b));
+}
+
+/**
+ * Counts every pair twice (x and x ^ a give the same output difference), so
+ * the counters hold the DDT entries directly (up to 256, hence 16 bits).
+ * Counting into one small row per input difference keeps everything in L1;
+ * the row maximum is a vectorizable scan.
+ */
+int differential_uniformity(const uint8_t *sbox) {
+  int result = 0;
+  for (int a = 1; a < 256; a++) {
+    uint16_t count[256];
+    memset(count, 0, sizeof(count));
+    for (int x = 0; x < 256; x++) {
+      count[sbox[x] ^ sbox[x ^ a]]++;
+    }
+    uint16_t row_max = 0;
+    for (int b = 0; b < 256; b++) {
+      row_max = std::max(row_max, count[b]);
+    }
+    result = std::max(result, (int)row_max);
+  }
+  return result;
+}
+
+// Largest |W| over all components, one in-place Walsh-Hadamard transform of
+// the truth table of each nonzero output mask b at a time
+int max_walsh_scalar(const uint8_t *sbox) {
+  int max_abs = 0;
+  for (int b = 1; b < 256; b++) {
+    int16_t w[256];
+    for (int x = 0; x < 256; x++) {
+      w[x] = (int16_t)hadamard_sign(b, sbox[x]);
+    }
+    for (int h = 1; h < 256; h <<= 1) {
+      for (int i = 0; i < 256; i += 2 * h) {
+        for (int j = i; j < i + h; j++) {
+          int16_t u = w[j];
+          int16_t v = w[j + h];
+          w[j] = u + v;
+          w[j + h] = u - v;
+        }
+      }
+    }
+    for (int a = 0; a < 256; a++) {
+      max_abs = std::max(max_abs, abs(w[a]));
+    }
+  }
+  return max_abs;
+}
+
+#ifdef KSA_HAVE_X86
+
+__attribute__((target("avx2"))) inline void butterfly(__m256i &u, __m256i &v) {
+  __m256i t = u;
+  u = _mm256_add_epi16(t, v);
+  v = _mm256_sub_epi16(t, v);
+}
+
+// Stages of stride 1, 2 and 4 (relative to r) of the transform on 8 rows
+__attribute__((target("avx2"))) inline void butterfly8(__m256i *r) {
+  butterfly(r[0], r[1]);
+  butterfly(r[2], r[3]);
+  butterfly(r[4], r[5]);
+  butterfly(r[6], r[7]);
+  butterfly(r[0], r[2]);
+  butterfly(r[1], r[3]);
+  butterfly(r[4], r[6]);
+  butterfly(r[5], r[7]);
+  butterfly(r[0], r[4]);
+  butterfly(r[1], r[5]);
+  butterfly(r[2], r[6]);
+  butterfly(r[3], r[7]);
+}
+
+/**
+ * Transforms 16 components at once: row x of w holds the signs
+ * (-1)^(b . S(x)) of components b = base..base+15 in 16 int16 lanes, and the
+ * butterflies run over the rows. Row x starts as row S(x) of the Hadamard
+ * matrix, which for base a multiple of 16 is the 16-entry row of the low
+ * nibble negated by the parity of (S(x) & base). The eight stages are grouped
+ * as 3 + 3 + 2 so that each pass works on registers and the 8 KB block of
+ * rows stays in L1; the last pass folds in the |W| maximum.
+ */
+__attribute__((target("avx2"))) int max_walsh_avx2(const uint8_t *sbox) {
+  alignas(32) int16_t low_rows[16][16];
+  for (int y = 0; y < 16; y++) {
+    for (int b = 0; b < 16; b++) {
+      low_rows[y][b] = (int16_t)hadamard_sign(y, b);
+    }
+  }
+  __m256i w[256];
+  __m256i best = _mm256_setzero_si256();
+
+  for (int base = 0; base < 256; base += 16) {
+    for (int x = 0; x < 256; x += 8) {
+      __m256i r[8];
+      for (int k = 0; k < 8; k++) {
+        int y = sbox[x + k];
+        __m256i row = _mm256_load_si256((const __m256i *)low_rows[y & 15]);
+        __m256i neg =
+            _mm256_set1_epi16((int16_t)-__builtin_parity((unsigned)(y & base)));
+        r[k] = _mm256_sub_epi16(_mm256_xor_si256(row, neg), neg);
+      }
+      butterfly8(r);
+      for (int k = 0; k < 8; k++) {
+        w[x + k] = r[k];
+      }
+    }
+
+    for (int group = 0; group < 256; group += 64) {
+      for (int o = 0; o < 8; o++) {
+        __m256i r[8];
+        for (int k = 0; k < 8; k++) {
+          r[k] = w[group + o + 8 * k];
+        }
+        butterfly8(r);
+        for (int k = 0; k < 8; k++) {
+          w[group + o + 8 * k] = r[k];
+        }
+      }
+    }
+
+    __m256i block_max = _mm256_setzero_si256();
+    for (int o = 0; o < 64; o++) {
+      __m256i r0 = w[o], r1 = w[o + 64], r2 = w[o + 128], r3 = w[o + 192];
+      butterfly(r0, r1);
+      butterfly(r2, r3);
+      butterfly(r0, r2);
+      butterfly(r1, r3);
+      __m256i m01 = _mm256_max_epi16(_mm256_abs_epi16(r0), _mm256_abs_epi16(r1));
+      __m256i m23 = _mm256_max_epi16(_mm256_abs_epi16(r2), _mm256_abs_epi16(r3));
+      block_max = _mm256_max_epi16(block_max, _mm256_max_epi16(m01, m23));
+    }
+    if (base == 0) {
+      // Component 0 is the constant function; leave it out
+      block_max = _mm256_and_si256(
+          block_max, _mm256_setr_epi16(0, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                       -1, -1, -1, -1, -1, -1));
+    }
+    best = _mm256_max_epi16(best, block_max);
+  }
+
+  alignas(32) int16_t lanes[16];
+  _mm256_store_si256((__m256i *)lanes, best);
+  return *std::max_element(lanes, lanes + 16);
+}
+
+#endif // KSA_HAVE_X86
+
+int max_walsh(const uint8_t *sbox) {
+#ifdef KSA_HAVE_X86
+  static const bool have_avx2 = __builtin_cpu_supports("avx2");
+  if (have_avx2) {
+    return max_walsh_avx2(sbox);
+  }
+#endif
+  return max_walsh_scalar(sbox);
+}
+
+inline uint64_t splitmix64(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+void analyze_key(uint64_t key, size_t index, KsaAnalysisStats &stats) {
+  KsaContext ctx;
+  generate_sboxes_and_subkeys(key, ctx);
+  KsaSboxMetrics metrics = analyze_sbox(ctx.sbox);
+  stats.keys++;
+  stats.differential_uniformity[metrics.differential_uniformity]++;
+  stats.nonlinearity[metrics.nonlinearity]++;
+  stats.fixed_points[metrics.fixed_points]++;
+
+  const int bit = (int)(index % 64);
+  KsaContext flipped;
+  generate_sboxes_and_subkeys(key ^ (1ULL << bit), flipped);
+  uint64_t changed = 0;
+  for (int x = 0; x < 256; x++) {
+    int bits = __builtin_popcount(ctx.enc_table[x] ^ flipped.enc_table[x]);
+    stats.flip_byte_bits[bits]++;
+    changed += bits;
+  }
+  stats.flip_bits_by_key_bit[bit] += changed;
+  stats.flips_by_key_bit[bit]++;
+}
+
+// Accumulator owned by one pool task, on its own cache lines
+struct alignas(64) TaskStats {
+  KsaAnalysisStats stats;
+};
+
+template <size_t N>
+void print_histogram(const char *name, const uint64_t (&hist)[N],
+                     uint64_t keys) {
+  size_t lo = N, hi = 0;
+  double sum = 0;
+  for (size_t v = 0; v < N; v++) {
+    if (hist[v] != 0) {
+      lo = std::min(lo, v);
+      hi = v;
+      sum += (double)v * hist[v];
+    }
+  }
+  if (lo == N) {
+    return;
+  }
+  printf("\n%s: min %zu, mean %.3f, max %zu\n", name, lo, sum / keys, hi);
+  for (size_t v = lo; v <= hi; v++) {
+    if (hist[v] != 0) {
+      printf("  %4zu %12llu  %7.3f%%\n", v, (unsigned long long)hist[v],
+             100.0 * hist[v] / keys);
+    }
+  }
+}
+
+void print_report(const KsaAnalysisStats &stats) {
+  print_histogram("differential uniformity", stats.differential_uniformity,
+                  stats.keys);
+  print_histogram("nonlinearity", stats.nonlinearity, stats.keys);
+  print_histogram("fixed points", stats.fixed_points, stats.keys);
+
+  uint64_t bytes = 0;
+  uint64_t bits = 0;
+  for (int k = 0; k <= 8; k++) {
+    bytes += stats.flip_byte_bits[k];
+    bits += (uint64_t)k * stats.flip_byte_bits[k];
+  }
+  if (bytes == 0) {
+    return;
+  }
+  printf("\nkey-bit-flip avalanche: %.4f of output bits change (ideal 0.5)\n",
+         (double)bits / (8.0 * bytes));
+  printf("  changed bits per byte   observed   binomial(8, 1/2)\n");
+  static const int binomial[9] = {1, 8, 28, 56, 70, 56, 28, 8, 1};
+  for (int k = 0; k <= 8; k++) {
+    printf("  %d %27.3f%% %9.3f%%\n", k, 100.0 * stats.flip_byte_bits[k] / bytes,
+           100.0 * binomial[k] / 256);
+  }
+  printf("  changed fraction per flipped key bit (bit 0 = LSB):\n");
+  for (int row = 0; row < 8; row++) {
+    printf("  %2d-%2d", row * 8, row * 8 + 7);
+    for (int col = 0; col < 8; col++) {
+      int bit = row * 8 + col;
+      uint64_t n = stats.flips_by_key_bit[bit];
+      printf(" %6.3f", n ? (double)stats.flip_bits_by_key_bit[bit] / (2048.0 * n)
+                         : 0.0);
+    }
+    printf("\n");
+  }
+}
+
+} // namespace
+
+KsaSboxMetrics analyze_sbox(const uint8_t *sbox) {
+  KsaSboxMetrics metrics;
+  metrics.differential_uniformity = differential_uniformity(sbox);
+  metrics.nonlinearity = 128 - max_walsh(sbox) / 2;
+  metrics.fixed_points = 0;
+  for (int x = 0; x < 256; x++) {
+    metrics.fixed_points += (sbox[x] == x);
+  }
+  return metrics;
+}
+
+void KsaAnalysisStats::merge(const KsaAnalysisStats &other) {
+  keys += other.keys;
+  for (size_t v = 0; v < 257; v++) {
+    differential_uniformity[v] += other.differential_uniformity[v];
+    fixed_points[v] += other.fixed_points[v];
+  }
+  for (size_t v = 0; v < 129; v++) {
+    nonlinearity[v] += other.nonlinearity[v];
+  }
+  for (size_t v = 0; v < 9; v++) {
+    flip_byte_bits[v] += other.flip_byte_bits[v];
+  }
+  for (size_t v = 0; v < 64; v++) {
+    flip_bits_by_key_bit[v] += other.flip_bits_by_key_bit[v];
+    flips_by_key_bit[v] += other.flips_by_key_bit[v];
+  }
+}
+
+uint64_t analysis_key(uint64_t seed, size_t i) {
+  return splitmix64(seed + i * 0x9E3779B97F4A7C15ULL);
+}
+
+void analyze_keys(uint64_t seed, size_t count, ThreadPool &pool,
+                  KsaAnalysisStats &stats, bool progress) {
+  const size_t blocks = (count + KSA_BATCH_BLOCK - 1) / KSA_BATCH_BLOCK;
+  std::vector<TaskStats> task_stats(pool.size());
+  std::atomic<size_t> next_block(0);
+  std::atomic<size_t> done_blocks(0);
+  const size_t report_every = std::max<size_t>(1, blocks / 100);
+
+  pool.parallel_for(task_stats.size(), [&](size_t task) {
+    KsaAnalysisStats &local = task_stats[task].stats;
+    for (size_t block = next_block++; block < blocks; block = next_block++) {
+      size_t begin = block * KSA_BATCH_BLOCK;
+      size_t end = std::min(count, begin + KSA_BATCH_BLOCK);
+      for (size_t i = begin; i < end; i++) {
+        analyze_key(analysis_key(seed, i), i, local);
+      }
+      size_t done = ++done_blocks;
+      if (progress && done % report_every == 0) {
+        fprintf(stderr, "\r%5.1f%%", 100.0 * done / blocks);
+      }
+    }
+  });
+  if (progress) {
+    fprintf(stderr, "\r       \r");
+  }
+
+  for (const TaskStats &t : task_stats) {
+    stats.merge(t.stats);
+  }
+}
+
+int run_analysis(int argc, char *argv[]) {
+  size_t count = 1000000;
+  unsigned threads = 0;
+  uint64_t seed = 12345;
+  for (int i = 0; i < argc; i++) {
+    std::string arg = argv[i];
+    if ((arg == "-j" || arg == "--threads") && i + 1 < argc) {
+      threads = (unsigned)std::stoul(argv[++i]);
+    } else if ((arg == "-s" || arg == "--seed") && i + 1 < argc) {
+      seed = std::stoull(argv[++i], nullptr, 0);
+    } else if (arg == "-h" || arg == "--help") {
+      printf("Usage: KSA-ASX-64_8bit analyze [-j N] [-s SEED] [KEYS]\n");
+      printf("  S-box differential uniformity, nonlinearity and fixed points\n");
+      printf("  and the key-bit-flip avalanche over KEYS keys "
+             "(default: %zu)\n",
+             count);
+      return 0;
+    } else {
+      count = std::stoul(arg);
+    }
+  }
+
+  ThreadPool pool(threads);
+  KsaAnalysisStats stats;
+  auto t0 = std::chrono::steady_clock::now();
+  analyze_keys(seed, count, pool, stats, isatty(STDERR_FILENO));
+  double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+          .count();
+
+  printf("keys: %zu, seed: 0x%llX, threads: %u, time: %.2f s, %.0f keys/s\n",
+         count, (unsigned long long)seed, pool.size(), seconds,
+         seconds > 0 ? count / seconds : 0.0);
+  print_report(stats);
+  return 0;
+}
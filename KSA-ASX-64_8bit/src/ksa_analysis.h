@@ -0,0 +1,65 @@
+#ifndef KSA_ANALYSIS_H
+#define KSA_ANALYSIS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ksa_cipher.h"
+#include "thread_pool.h"
+
+// Cryptographic quality of the key-dependent S-boxes over large key samples.
+
+/**
+ * @brief Quality metrics of one 8-bit S-box.
+ */
+struct KsaSboxMetrics {
+  // Largest entry of the difference distribution table over input
+  // differences a != 0: max #{x : S(x) ^ S(x ^ a) == b}. Lower is better.
+  int differential_uniformity;
+  // 128 - max|W| / 2 over the Walsh spectra of all nonzero output masks, i.e.
+  // the distance to the closest affine function. Higher is better.
+  int nonlinearity;
+  // Number of x with S(x) == x
+  int fixed_points;
+};
+
+KsaSboxMetrics analyze_sbox(const uint8_t *sbox);
+
+/**
+ * @brief Histograms over a key sample, indexed by the metric value.
+ *
+ * Avalanche: for key i, bit (i % 64) of the key is flipped and the two
+ * enc_tables are compared over all 256 inputs, so every key bit is sampled
+ * equally often.
+ */
+struct KsaAnalysisStats {
+  uint64_t keys = 0;
+  uint64_t differential_uniformity[257] = {};
+  uint64_t nonlinearity[129] = {};
+  uint64_t fixed_points[257] = {};
+  // Encrypted bytes per number of output bits (0-8) changed by the key flip
+  uint64_t flip_byte_bits[9] = {};
+  // Changed output bits (out of 2048 per key) summed per flipped key bit
+  uint64_t flip_bits_by_key_bit[64] = {};
+  uint64_t flips_by_key_bit[64] = {};
+
+  void merge(const KsaAnalysisStats &other);
+};
+
+// Key i of the sample drawn from seed; independent of the thread count
+uint64_t analysis_key(uint64_t seed, size_t i);
+
+/**
+ * @brief Analyze count keys on the pool.
+ *
+ * Every pool task owns one accumulator and takes blocks of keys from a shared
+ * atomic counter, so no lock is taken while analyzing; the accumulators are
+ * merged into stats at the end.
+ */
+void analyze_keys(uint64_t seed, size_t count, ThreadPool &pool,
+                  KsaAnalysisStats &stats, bool progress = false);
+
+// Command line entry: KSA-ASX-64_8bit analyze ...
+int run_analysis(int argc, char *argv[]);
+
+#endif // KSA_ANALYSIS_H
@@ -0,0 +1,15 @@
+#include "ksa_batch.h"
+
+#include <algorithm>
+
+void generate_key_schedules(const uint64_t *keys, size_t n, KsaContext *ctxs,
+                            ThreadPool &pool) {
+  const size_t blocks = (n + KSA_BATCH_BLOCK - 1) / KSA_BATCH_BLOCK;
+  pool.parallel_for(blocks, [&](size_t block) {
+    size_t begin = block * KSA_BATCH_BLOCK;
+    size_t end = std::min(n, begin + KSA_BATCH_BLOCK);
+    for (size_t i = begin; i < end; i++) {
+      generate_sboxes_and_subkeys(keys[i], ctxs[i]);
+    }
+  });
+}
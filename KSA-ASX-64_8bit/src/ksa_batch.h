@@ -0,0 +1,23 @@
+#ifndef KSA_BATCH_H
+#define KSA_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ksa_cipher.h"
+#include "thread_pool.h"
+
+// Keys handed to one pool task; large enough to amortize the atomic counter,
+// small enough to balance the load across threads
+const size_t KSA_BATCH_BLOCK = 64;
+
+/**
+ * @brief Build the key schedules of n keys into a contiguous array of
+ * contexts on a thread pool: ctxs[i] is the context of keys[i].
+ *
+ * Nothing is printed, so the loop stays free of stdout I/O.
+ */
+void generate_key_schedules(const uint64_t *keys, size_t n, KsaContext *ctxs,
+                            ThreadPool &pool);
+
+#endif // KSA_BATCH_H
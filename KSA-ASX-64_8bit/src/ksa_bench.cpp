@@ -0,0 +1,354 @@
+#include "ksa_bench.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "ksa_cipher.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// In-place transform of n bytes; the byte paths are measured the way a
+// caller without the buffer API would loop over encrypt_byte/decrypt_byte
+typedef void (*BenchOp)(const KsaContext &ctx, uint8_t *data, size_t n);
+
+void op_encrypt_byte(const KsaContext &ctx, uint8_t *data, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    data[i] = encrypt_byte(ctx, data[i]);
+  }
+}
+
+void op_decrypt_byte(const KsaContext &ctx, uint8_t *data, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    data[i] = decrypt_byte(ctx, data[i]);
+  }
+}
+
+void op_encrypt_buffer(const KsaContext &ctx, uint8_t *data, size_t n) {
+  encrypt_buffer(ctx, data, data, n);
+}
+
+void op_decrypt_buffer(const KsaContext &ctx, uint8_t *data, size_t n) {
+  decrypt_buffer(ctx, data, data, n);
+}
+
+struct BenchOpInfo {
+  const char *name;
+  BenchOp fn;
+};
+
+const BenchOpInfo BENCH_OPS[] = {
+    {"encrypt_byte", op_encrypt_byte},
+    {"decrypt_byte", op_decrypt_byte},
+    {"encrypt_buffer", op_encrypt_buffer},
+    {"decrypt_buffer", op_decrypt_buffer},
+};
+
+struct BenchOptions {
+  std::string output = "-";
+  size_t max_size = (size_t)1 << 30;
+  double min_time = 0.2; // Seconds per measurement
+  size_t keys = 100000;  // Key-setup latency samples
+};
+
+inline uint64_t splitmix64(uint64_t &state) {
+  uint64_t x = (state += 0x9E3779B97F4A7C15ULL);
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+// Keeps the compiler from dropping work whose result is never read
+inline void clobber(const void *p) { asm volatile("" : : "r"(p) : "memory"); }
+
+double seconds_between(Clock::time_point t0, Clock::time_point t1) {
+  return std::chrono::duration<double>(t1 - t0).count();
+}
+
+// Accepts plain bytes or a K/M/G suffix (powers of 1024)
+bool parse_size(const char *text, size_t &size) {
+  char *end = nullptr;
+  errno = 0;
+  unsigned long long value = strtoull(text, &end, 10);
+  if (errno != 0 || end == text) {
+    return false;
+  }
+  int shift = 0;
+  if (*end == 'K' || *end == 'k') {
+    shift = 10;
+  } else if (*end == 'M' || *end == 'm') {
+    shift = 20;
+  } else if (*end == 'G' || *end == 'g') {
+    shift = 30;
+  }
+  if (shift != 0) {
+    end++;
+  }
+  size = (size_t)value << shift;
+  return *end == '\0' && size > 0;
+}
+
+size_t last_level_cache() {
+  long size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+  if (size <= 0) {
+    size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+  }
+  return size > 0 ? (size_t)size : (size_t)32 << 20;
+}
+
+std::string cpu_model() {
+  std::string model = "unknown";
+  FILE *f = fopen("/proc/cpuinfo", "r");
+  if (f == nullptr) {
+    return model;
+  }
+  char line[512];
+  while (fgets(line, sizeof(line), f) != nullptr) {
+    if (strncmp(line, "model name", 10) == 0) {
+      const char *colon = strchr(line, ':');
+      if (colon != nullptr) {
+        model = colon + 1;
+        model.erase(0, model.find_first_not_of(" \t"));
+        model.erase(model.find_last_not_of(" \t\r\n") + 1);
+      }
+      break;
+    }
+  }
+  fclose(f);
+  return model;
+}
+
+std::string json_string(const std::string &s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if ((unsigned char)c >= 0x20) {
+      out += c;
+    }
+  }
+  return out + "\"";
+}
+
+struct LatencyStats {
+  double mean = 0;
+  uint32_t p50 = 0, p90 = 0, p99 = 0, p999 = 0, max = 0;
+  double timer_overhead = 0;
+};
+
+// Every key setup is timed on its own; the median cost of an empty timed
+// region is reported alongside so small deltas can be judged
+LatencyStats measure_key_setup(size_t keys) {
+  LatencyStats stats;
+  std::vector<uint32_t> ns(keys);
+  KsaContext ctx;
+  uint64_t state = 12345;
+  for (size_t i = 0; i < keys; i++) {
+    uint64_t key = splitmix64(state);
+    auto t0 = Clock::now();
+    generate_sboxes_and_subkeys(key, ctx);
+    clobber(&ctx);
+    auto t1 = Clock::now();
+    ns[i] = (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                t1 - t0)
+                .count();
+  }
+
+  std::vector<uint32_t> empty(1001);
+  for (auto &v : empty) {
+    auto t0 = Clock::now();
+    auto t1 = Clock::now();
+    v = (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0)
+            .count();
+  }
+  std::sort(empty.begin(), empty.end());
+  stats.timer_overhead = empty[empty.size() / 2];
+
+  if (keys == 0) {
+    return stats;
+  }
+  std::sort(ns.begin(), ns.end());
+  double sum = 0;
+  for (uint32_t v : ns) {
+    sum += v;
+  }
+  auto pct = [&](double q) {
+    return ns[std::min(keys - 1, (size_t)(q * keys))];
+  };
+  stats.mean = sum / keys;
+  stats.p50 = pct(0.50);
+  stats.p90 = pct(0.90);
+  stats.p99 = pct(0.99);
+  stats.p999 = pct(0.999);
+  stats.max = ns.back();
+  return stats;
+}
+
+struct Throughput {
+  uint64_t iterations = 0;
+  double seconds = 0;
+};
+
+/**
+ * Runs op on size-byte buffers until min_time has passed, doubling the batch
+ * between clock reads so short buffers are not dominated by the timer.
+ * Resident runs reuse the start of the arena; streaming runs walk the arena
+ * buffer by buffer, which is larger than the last-level cache, so every
+ * buffer has been evicted by the time it comes around again.
+ */
+Throughput measure(const KsaContext &ctx, BenchOp op, uint8_t *arena,
+                   size_t arena_size, size_t size, bool streaming,
+                   double min_time) {
+  const size_t slots = streaming ? arena_size / size : 1;
+  size_t slot = 0;
+  op(ctx, arena, size); // Warm-up: page tables, branch predictors, CPUID
+
+  Throughput result;
+  uint64_t batch = 1;
+  auto t0 = Clock::now();
+  while (true) {
+    for (uint64_t b = 0; b < batch; b++) {
+      op(ctx, arena + slot * size, size);
+      if (++slot == slots) {
+        slot = 0;
+      }
+    }
+    result.iterations += batch;
+    result.seconds = seconds_between(t0, Clock::now());
+    if (result.seconds >= min_time) {
+      break;
+    }
+    batch *= 2;
+  }
+  clobber(arena);
+  return result;
+}
+
+void bench_usage() {
+  printf("Usage: KSA-ASX-64_8bit bench-json [options]\n");
+  printf("  -o, --output FILE    write JSON to FILE (default: stdout)\n");
+  printf("  --max-size SIZE      largest buffer, e.g. 64M (default: 1G)\n");
+  printf("  --min-time SEC       time per measurement (default: 0.2)\n");
+  printf("  --keys N             key-setup latency samples (default: "
+         "100000)\n");
+}
+
+} // namespace
+
+int run_bench_json(int argc, char *argv[]) {
+  BenchOptions opt;
+  for (int i = 0; i < argc; i++) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if ((arg == "-o" || arg == "--output") && has_value) {
+      opt.output = argv[++i];
+    } else if (arg == "--max-size" && has_value) {
+      if (!parse_size(argv[++i], opt.max_size)) {
+        fprintf(stderr, "Error: invalid size %s\n", argv[i]);
+        return 1;
+      }
+    } else if (arg == "--min-time" && has_value) {
+      opt.min_time = atof(argv[++i]);
+    } else if (arg == "--keys" && has_value) {
+      opt.keys = std::stoul(argv[++i]);
+    } else {
+      bench_usage();
+      return (arg == "-h" || arg == "--help") ? 0 : 1;
+    }
+  }
+
+  // Sizes 16 B, 256 B, 4 KB, ... growing 16x per step, ending at max_size
+  std::vector<size_t> sizes;
+  for (size_t size = 16; size < opt.max_size; size <<= 4) {
+    sizes.push_back(size);
+  }
+  sizes.push_back(opt.max_size);
+  const size_t llc = last_level_cache();
+  const size_t arena_size = std::max(sizes.back(), 2 * llc);
+  std::unique_ptr<uint8_t[]> arena(new (std::nothrow) uint8_t[arena_size]);
+  if (!arena) {
+    fprintf(stderr, "Error: cannot allocate a %zu byte arena\n", arena_size);
+    return 1;
+  }
+  // Random contents; this also commits every page before timing starts
+  uint64_t state = 1;
+  for (size_t i = 0; i < arena_size; i += 8) {
+    uint64_t v = splitmix64(state);
+    memcpy(arena.get() + i, &v, std::min<size_t>(8, arena_size - i));
+  }
+
+  FILE *out = (opt.output == "-") ? stdout : fopen(opt.output.c_str(), "w");
+  if (out == nullptr) {
+    fprintf(stderr, "Error: %s: %s\n", opt.output.c_str(), strerror(errno));
+    return 1;
+  }
+
+  KsaContext ctx;
+  generate_sboxes_and_subkeys(0x123456789ABCDEF1ULL, ctx);
+
+  fprintf(stderr, "key setup: %zu samples\n", opt.keys);
+  LatencyStats latency = measure_key_setup(opt.keys);
+
+  fprintf(out, "{\n");
+  fprintf(out, "  \"benchmark\": \"KSA-ASX-64_8bit\",\n");
+  fprintf(out, "  \"cpu\": %s,\n", json_string(cpu_model()).c_str());
+  fprintf(out, "  \"buffer_impl\": \"%s\",\n",
+          ksa_buffer_impl_name(ksa_buffer_auto_impl()));
+  fprintf(out, "  \"llc_bytes\": %zu,\n", llc);
+  fprintf(out, "  \"streaming_arena_bytes\": %zu,\n", arena_size);
+  fprintf(out, "  \"min_time_s\": %g,\n", opt.min_time);
+  fprintf(out, "  \"key_setup_ns\": {\"samples\": %zu, \"mean\": %.1f, "
+               "\"p50\": %u, \"p90\": %u, \"p99\": %u, \"p999\": %u, "
+               "\"max\": %u, \"timer_overhead\": %.0f},\n",
+          opt.keys, latency.mean, latency.p50, latency.p90, latency.p99,
+          latency.p999, latency.max, latency.timer_overhead);
+  fprintf(out, "  \"throughput\": [");
+
+  bool first = true;
+  for (const BenchOpInfo &op : BENCH_OPS) {
+    for (size_t size : sizes) {
+      for (int streaming = 0; streaming <= 1; streaming++) {
+        // A buffer larger than half the cache is not resident anyway
+        if (!streaming && size > llc / 2) {
+          continue;
+        }
+        const char *mode = streaming ? "streaming" : "resident";
+        Throughput t = measure(ctx, op.fn, arena.get(), arena_size, size,
+                               streaming, opt.min_time);
+        double bytes_per_sec = (double)t.iterations * size / t.seconds;
+        fprintf(stderr, "%-15s %-9s %11zu B %10.1f MB/s\n", op.name, mode,
+                size, bytes_per_sec / (1 << 20));
+        fprintf(out, "%s\n    {\"op\": \"%s\", \"mode\": \"%s\", \"size\": %zu, "
+                     "\"iterations\": %llu, \"seconds\": %.6f, "
+                     "\"bytes_per_sec\": %.0f}",
+                first ? "" : ",", op.name, mode, size,
+                (unsigned long long)t.iterations, t.seconds, bytes_per_sec);
+        first = false;
+      }
+    }
+  }
+  fprintf(out, "\n  ]\n}\n");
+
+  bool ok = !ferror(out);
+  if (out != stdout) {
+    ok = (fclose(out) == 0) && ok;
+  }
+  if (!ok) {
+    fprintf(stderr, "Error: failed to write %s\n", opt.output.c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,20 @@
+#ifndef KSA_BENCH_H
+#define KSA_BENCH_H
+
+#include <stddef.h>
+
+/**
+ * @brief Machine-readable benchmark of the cipher, written as JSON so that
+ * results of two revisions can be diffed (`make bench`).
+ *
+ * Reports the key-setup latency distribution and the throughput of
+ * encrypt_byte, decrypt_byte, encrypt_buffer and decrypt_buffer for buffer
+ * sizes from 16 B up to --max-size. Every size is measured twice:
+ * - resident: the same buffer over and over, so it stays in cache (only for
+ *   sizes up to half the last-level cache);
+ * - streaming: consecutive buffers through an arena larger than the
+ *   last-level cache, so the data comes from memory.
+ */
+int run_bench_json(int argc, char *argv[]);
+
+#endif // KSA_BENCH_H
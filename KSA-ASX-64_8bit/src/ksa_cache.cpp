@@ -0,0 +1,65 @@
+#include "ksa_cache.h"
+
+#include <algorithm>
+#include <chrono>
+
+KsaContextCache::KsaContextCache(size_t capacity)
+    : m_capacity(std::max<size_t>(1, capacity)) {
+  m_index.reserve(m_capacity);
+}
+
+std::shared_ptr<const KsaContext> KsaContextCache::get(uint64_t key) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+      m_lru.splice(m_lru.begin(), m_lru, it->second);
+      m_stats.hits++;
+      return it->second->second;
+    }
+  }
+
+  // Build outside the lock so that other keys can still be served meanwhile
+  auto t0 = std::chrono::steady_clock::now();
+  std::shared_ptr<KsaContext> ctx = std::make_shared<KsaContext>();
+  generate_sboxes_and_subkeys(key, *ctx);
+  auto t1 = std::chrono::steady_clock::now();
+  uint64_t ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stats.misses++;
+  m_stats.setup_ns_total += ns;
+  m_stats.setup_ns_max = std::max(m_stats.setup_ns_max, ns);
+
+  // Another thread may have inserted the same key while we were building
+  auto it = m_index.find(key);
+  if (it != m_index.end()) {
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return it->second->second;
+  }
+
+  if (m_lru.size() >= m_capacity) {
+    m_index.erase(m_lru.back().first);
+    m_lru.pop_back();
+    m_stats.evictions++;
+  }
+  m_lru.emplace_front(key, ctx);
+  m_index[key] = m_lru.begin();
+  return ctx;
+}
+
+KsaCacheStats KsaContextCache::stats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+void KsaContextCache::reset_stats() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stats = KsaCacheStats();
+}
+
+size_t KsaContextCache::size() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_lru.size();
+}
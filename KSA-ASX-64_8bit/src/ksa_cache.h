@@ -0,0 +1,73 @@
+#ifndef KSA_CACHE_H
+#define KSA_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "ksa_cipher.h"
+
+/**
+ * @brief Counters of a KsaContextCache.
+ *
+ * Setup latency is the time generate_sboxes_and_subkeys() took on misses;
+ * hits cost no key-schedule work.
+ */
+struct KsaCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+  uint64_t setup_ns_total = 0; // Sum of key-setup time over all misses
+  uint64_t setup_ns_max = 0;   // Slowest single key setup
+
+  double hit_rate() const {
+    uint64_t lookups = hits + misses;
+    return lookups > 0 ? (double)hits / lookups : 0.0;
+  }
+
+  double avg_setup_ns() const {
+    return misses > 0 ? (double)setup_ns_total / misses : 0.0;
+  }
+};
+
+/**
+ * @brief Bounded LRU cache of prepared key contexts, keyed by the 64-bit key.
+ *
+ * Switching between many device keys reuses the prepared tables instead of
+ * rerunning the KSA loop, the inverse table and the table fusion. get() is
+ * thread-safe. Contexts are handed out as shared_ptr, so an entry evicted
+ * while another thread still uses it stays valid until that thread drops it.
+ */
+class KsaContextCache {
+public:
+  explicit KsaContextCache(size_t capacity);
+  KsaContextCache(const KsaContextCache &) = delete;
+  KsaContextCache &operator=(const KsaContextCache &) = delete;
+
+  /**
+   * @brief Return the context of key, building it on a miss and evicting the
+   * least recently used entry when the cache is full.
+   */
+  std::shared_ptr<const KsaContext> get(uint64_t key);
+
+  KsaCacheStats stats() const;
+  void reset_stats();
+
+  size_t size() const;
+  size_t capacity() const { return m_capacity; }
+
+private:
+  typedef std::pair<uint64_t, std::shared_ptr<const KsaContext>> Entry;
+
+  const size_t m_capacity;
+  mutable std::mutex m_mutex;
+  std::list<Entry> m_lru; // Most recently used first
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> m_index;
+  KsaCacheStats m_stats;
+};
+
+#endif // KSA_CACHE_H
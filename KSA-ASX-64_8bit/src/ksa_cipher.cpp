@@ -0,0 +1,24 @@
+#include "ksa_cipher.h"
+
+#include <stdio.h>
+
+// Context behind the single-key API. Only the demo uses it.
+static KsaContext default_ctx;
+
+void generate_sboxes_and_subkeys(uint64_t key_64bit) {
+  generate_sboxes_and_subkeys(key_64bit, default_ctx);
+
+  printf(
+      "S-box, inverse S-box and subkeys generated (based on key: 0x%016llX).\n",
+      (unsigned long long)key_64bit);
+  printf("  Subkey (addition): 0x%02X, Subkey (XOR): 0x%02X\n",
+         default_ctx.subkey_add, default_ctx.subkey_xor);
+}
+
+uint8_t encrypt_byte(uint8_t data_A) {
+  return encrypt_byte(default_ctx, data_A);
+}
+
+uint8_t decrypt_byte(uint8_t data_B) {
+  return decrypt_byte(default_ctx, data_B);
+}
@@ -0,0 +1,187 @@
+#ifndef KSA_CIPHER_H
+#define KSA_CIPHER_H
+
+#include <stddef.h> // For size_t
+#include <stdint.h> // For fixed-width integer types: uint64_t, uint8_t
+
+// Key-dependent 8-bit cipher: (A + subkey_add) % 256 -> S-box -> XOR subkey_xor.
+//
+// All key material lives in a KsaContext. A context is built once per key and
+// is only read afterwards, so any number of threads may encrypt and decrypt
+// with the same context, and one process may hold contexts for many keys.
+
+/**
+ * @brief Key schedule for one 64-bit key: S-box, inverse S-box, subkeys and
+ * the fused single-lookup tables derived from them.
+ *
+ * The three encryption steps only depend on the key and the input byte, so
+ * they fold into one 256-byte permutation:
+ *   enc_table[A] = sbox[(A + subkey_add) % 256] ^ subkey_xor
+ *   dec_table[B] = (inv_sbox[B ^ subkey_xor] - subkey_add + 256) % 256
+ * encrypt_byte/decrypt_byte and the buffer functions only read the fused
+ * tables; sbox and inv_sbox are kept for analysis.
+ */
+struct KsaContext {
+  uint8_t enc_table[256];
+  uint8_t dec_table[256];
+  uint8_t sbox[256];
+  uint8_t inv_sbox[256];
+  uint8_t subkey_add; // Subkey for modular addition
+  uint8_t subkey_xor; // Subkey for XOR operation
+};
+
+/**
+ * @brief Generate S-box, inverse S-box, subkeys and the fused tables of a
+ * 64-bit key into ctx.
+ *
+ * Touches no global state and prints nothing, so it may run concurrently on
+ * different contexts. It is constexpr so that fixed keys can be scheduled at
+ * compile time (see ksa_tables.h).
+ *
+ * This function is based on a simplified version of Key Scheduling Algorithm
+ * (KSA), ensuring generation of a key-related permutation of 256 bytes. At the
+ * same time, it derives two 8-bit subkeys from the 64-bit master key.
+ *
+ * @param key_64bit 64-bit key for S-box initialization and confusion, and
+ * subkey derivation.
+ * @param ctx Context to fill.
+ */
+constexpr void generate_sboxes_and_subkeys(uint64_t key_64bit,
+                                           KsaContext &ctx) {
+  int i = 0, j = 0;
+  uint8_t *sbox = ctx.sbox;
+
+  // 1. Initialize S-box: sbox[i] = i
+  for (i = 0; i < 256; i++) {
+    sbox[i] = i;
+  }
+
+  // 2. Decompose 64-bit key into 8 8-bit bytes for S-box confusion and subkey
+  // derivation
+  uint8_t k_bytes[8] = {};
+  for (i = 0; i < 8; i++) {
+    k_bytes[i] = (uint8_t)((key_64bit >> (i * 8)) & 0xFF);
+  }
+
+  // 3. KSA-like confusion process: shuffle S-box according to key
+  // This is a key step to ensure permutation generation, similar to RC4's KSA.
+  j = 0;
+  for (i = 0; i < 256; i++) {
+    j = (j + sbox[i] + k_bytes[i % 8]) %
+        256; // Introduce confusion of key bytes and current S-box state
+    // Swap sbox[i] and sbox[j]
+    uint8_t temp = sbox[i];
+    sbox[i] = sbox[j];
+    sbox[j] = temp;
+  }
+
+  // 4. Generate inverse S-box
+  // If sbox[x] = y, then inv_sbox[y] = x
+  for (i = 0; i < 256; i++) {
+    ctx.inv_sbox[sbox[i]] = i;
+  }
+
+  // 5. Derive subkeys
+  // Here simply use two bytes of the key as subkeys.
+  // More complex derivation methods can provide better security, but sufficient
+  // for 8-bit operations.
+  ctx.subkey_add = k_bytes[0]; // Use first byte of key as modular addition subkey
+  ctx.subkey_xor = k_bytes[1]; // Use second byte of key as XOR subkey
+
+  // 6. Fuse modular addition, S-box and XOR into one table per direction
+  for (i = 0; i < 256; i++) {
+    ctx.enc_table[i] = sbox[(i + ctx.subkey_add) % 256] ^ ctx.subkey_xor;
+    ctx.dec_table[i] =
+        (ctx.inv_sbox[i ^ ctx.subkey_xor] - ctx.subkey_add + 256) % 256;
+  }
+}
+
+/**
+ * @brief Encryption function: encrypt 8-bit data A into 8-bit data B with the
+ * key schedule in ctx. Thread-safe.
+ *
+ * Encryption process: (A + subkey_add) % 256 -> S-box lookup -> result XOR
+ * subkey_xor
+ *
+ * @param ctx Key schedule built by generate_sboxes_and_subkeys().
+ * @param data_A Original 8-bit data.
+ * @return Encrypted 8-bit data B.
+ */
+inline uint8_t encrypt_byte(const KsaContext &ctx, uint8_t data_A) {
+  // All three steps are precomputed in enc_table
+  return ctx.enc_table[data_A];
+}
+
+/**
+ * @brief Decryption function: decrypt 8-bit data B back to 8-bit data A with
+ * the key schedule in ctx. Thread-safe.
+ *
+ * Decryption process: B XOR subkey_xor -> inverse S-box lookup -> (result -
+ * subkey_add + 256) % 256
+ *
+ * @param ctx Key schedule built by generate_sboxes_and_subkeys().
+ * @param data_B Encrypted 8-bit data.
+ * @return Restored original 8-bit data A.
+ */
+inline uint8_t decrypt_byte(const KsaContext &ctx, uint8_t data_B) {
+  // All three reverse steps are precomputed in dec_table
+  return ctx.dec_table[data_B];
+}
+
+// Implementation of the buffer functions; Auto picks the fastest one the CPU
+// supports (checked through CPUID at the first call): VBMI, else Scalar.
+enum class KsaBufferImpl {
+  Auto,
+  Scalar,     // One fused-table lookup per byte
+  Ssse3,      // PSHUFB over 16 sub-tables, 16 bytes per step
+  Avx2,       // VPSHUFB over 16 sub-tables, 32 bytes per step
+  Avx512Vbmi, // Two VPERMI2B per 64 bytes
+};
+
+/**
+ * @brief Encrypt n bytes from in to out; out[i] == encrypt_byte(ctx, in[i]).
+ *
+ * in and out may be the same buffer. Thread-safe.
+ */
+void encrypt_buffer(const KsaContext &ctx, const uint8_t *in, uint8_t *out,
+                    size_t n);
+void encrypt_buffer(const KsaContext &ctx, const uint8_t *in, uint8_t *out,
+                    size_t n, KsaBufferImpl impl);
+
+/**
+ * @brief Decrypt n bytes from in to out; out[i] == decrypt_byte(ctx, in[i]).
+ *
+ * in and out may be the same buffer. Thread-safe.
+ */
+void decrypt_buffer(const KsaContext &ctx, const uint8_t *in, uint8_t *out,
+                    size_t n);
+void decrypt_buffer(const KsaContext &ctx, const uint8_t *in, uint8_t *out,
+                    size_t n, KsaBufferImpl impl);
+
+// Whether the CPU supports impl (Auto and Scalar are always supported)
+bool ksa_buffer_supported(KsaBufferImpl impl);
+const char *ksa_buffer_impl_name(KsaBufferImpl impl);
+
+// Implementation that Auto resolves to on this CPU
+KsaBufferImpl ksa_buffer_auto_impl();
+
+// --- Single-key API kept for the demo ---
+// These operate on one process-wide context and are NOT thread-safe; new code
+// should use the KsaContext overloads above.
+
+/**
+ * @brief Generate the process-wide key schedule and print the subkeys.
+ */
+void generate_sboxes_and_subkeys(uint64_t key_64bit);
+
+/**
+ * @brief Encrypt one byte with the process-wide key schedule.
+ */
+uint8_t encrypt_byte(uint8_t data_A);
+
+/**
+ * @brief Decrypt one byte with the process-wide key schedule.
+ */
+uint8_t decrypt_byte(uint8_t data_B);
+
+#endif // KSA_CIPHER_H
@@ -0,0 +1,596 @@
+#include "ksa_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Page alignment keeps the buffers friendly to the page cache and O_DIRECT
+const size_t BUFFER_ALIGN = 4096;
+// Piece of a stream buffer handed to one pool task
+const size_t STREAM_TASK_SIZE = 1 << 20;
+
+class AlignedBuffer {
+public:
+  AlignedBuffer() = default;
+  explicit AlignedBuffer(size_t size) { resize(size); }
+  ~AlignedBuffer() { free(m_data); }
+  AlignedBuffer(const AlignedBuffer &) = delete;
+  AlignedBuffer &operator=(const AlignedBuffer &) = delete;
+
+  void resize(size_t size) {
+    if (size <= m_size) {
+      return;
+    }
+    free(m_data);
+    m_data = nullptr;
+    m_size = 0;
+    void *p = nullptr;
+    if (posix_memalign(&p, BUFFER_ALIGN, size) == 0) {
+      m_data = (uint8_t *)p;
+      m_size = size;
+    }
+  }
+
+  uint8_t *data() { return m_data; }
+  size_t size() const { return m_size; }
+
+private:
+  uint8_t *m_data = nullptr;
+  size_t m_size = 0;
+};
+
+void crypt(const KsaContext &ctx, bool decrypt, const uint8_t *in,
+           uint8_t *out, size_t n) {
+  if (decrypt) {
+    decrypt_buffer(ctx, in, out, n);
+  } else {
+    encrypt_buffer(ctx, in, out, n);
+  }
+}
+
+// Reads until size bytes or end of input. With stop_fd >= 0 each read first
+// waits for fd or stop_fd to become readable, and a readable stop_fd cancels
+// the read (-1, ECANCELED) so a reader blocked on a silent pipe can be woken.
+ssize_t read_full(int fd, uint8_t *buffer, size_t size, int stop_fd = -1) {
+  size_t done = 0;
+  while (done < size) {
+    if (stop_fd >= 0) {
+      struct pollfd fds[2] = {{fd, POLLIN, 0}, {stop_fd, POLLIN, 0}};
+      if (poll(fds, 2, -1) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return -1;
+      }
+      if (fds[1].revents != 0) {
+        errno = ECANCELED;
+        return -1;
+      }
+    }
+    ssize_t n = read(fd, buffer + done, size - done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (n == 0) {
+      break;
+    }
+    done += (size_t)n;
+  }
+  return (ssize_t)done;
+}
+
+bool write_full(int fd, const uint8_t *data, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, data, len);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+bool pwrite_full(int fd, const uint8_t *data, size_t len, off_t offset) {
+  while (len > 0) {
+    ssize_t n = pwrite(fd, data, len, offset);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += n;
+    len -= (size_t)n;
+    offset += n;
+  }
+  return true;
+}
+
+std::string errno_message(const std::string &what) {
+  return what + ": " + strerror(errno);
+}
+
+bool parse_key(const char *text, uint64_t &key) {
+  char *end = nullptr;
+  errno = 0;
+  key = strtoull(text, &end, 0);
+  return errno == 0 && end != text && *end == '\0';
+}
+
+double seconds_since(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+      .count();
+}
+
+void report(const char *what, const char *mode, uint64_t bytes, double seconds,
+            unsigned threads) {
+  double mb = (double)bytes / (1 << 20);
+  fprintf(stderr, "%s: %.2f MB in %.3f s, %.1f MB/s (%s mode, %u threads)\n",
+          what, mb, seconds, seconds > 0 ? mb / seconds : 0.0, mode, threads);
+}
+
+bool is_regular_file(const std::string &path) {
+  struct stat st;
+  return path != "-" && stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+// File mode sizes the output with ftruncate and writes it at offsets, so the
+// output must be a regular file or not exist yet (devices such as /dev/null
+// and FIFOs go through stream mode)
+bool is_file_output(const std::string &path) {
+  struct stat st;
+  if (path == "-") {
+    return false;
+  }
+  if (stat(path.c_str(), &st) != 0) {
+    return errno == ENOENT;
+  }
+  return S_ISREG(st.st_mode);
+}
+
+void crypt_usage(bool decrypt) {
+  const char *cmd = decrypt ? "decrypt" : "encrypt";
+  printf("Usage: KSA-ASX-64_8bit %s -k KEY [options] <input> <output>\n", cmd);
+  printf("  \"-\" as input or output streams through stdin/stdout\n");
+  printf("  -k, --key KEY        64-bit key (decimal or 0x-prefixed hex)\n");
+  printf("  -j, --threads N      worker threads (default: all cores)\n");
+  printf("  -c, --chunk MB       chunk (file mode) or buffer (stream mode) size "
+         "(default: %zu)\n",
+         KSA_FILE_CHUNK >> 20);
+}
+
+} // namespace
+
+bool ksa_crypt_file(const KsaContext &ctx, bool decrypt, const std::string &in,
+                    const std::string &out, ThreadPool &pool, size_t chunk,
+                    uint64_t &bytes, std::string &error) {
+  int in_fd = open(in.c_str(), O_RDONLY | O_CLOEXEC);
+  if (in_fd < 0) {
+    error = errno_message(in);
+    return false;
+  }
+  struct stat in_st;
+  if (fstat(in_fd, &in_st) != 0) {
+    error = errno_message(in);
+    close(in_fd);
+    return false;
+  }
+
+  // Truncating the output would destroy the input if both are the same file
+  struct stat out_st;
+  if (stat(out.c_str(), &out_st) == 0 && out_st.st_dev == in_st.st_dev &&
+      out_st.st_ino == in_st.st_ino) {
+    error = out + ": output is the same file as the input";
+    close(in_fd);
+    return false;
+  }
+
+  int out_fd = open(out.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (out_fd < 0) {
+    error = errno_message(out);
+    close(in_fd);
+    return false;
+  }
+
+  const size_t size = (size_t)in_st.st_size;
+  bool ok = true;
+  // Size the output up front so that pieces can land in any order
+  if (ftruncate(out_fd, (off_t)size) != 0) {
+    error = errno_message(out);
+    ok = false;
+  }
+
+  void *map = MAP_FAILED;
+  if (ok && size > 0) {
+    map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, in_fd, 0);
+    if (map == MAP_FAILED) {
+      error = errno_message(in);
+      ok = false;
+    }
+  }
+
+  if (ok && size > 0) {
+    madvise(map, size, MADV_SEQUENTIAL);
+    const uint8_t *src = (const uint8_t *)map;
+    const size_t pieces = (size + chunk - 1) / chunk;
+    std::atomic<int> write_errno(0);
+
+    pool.parallel_for(pieces, [&](size_t k) {
+      static thread_local AlignedBuffer buffer;
+      if (write_errno.load(std::memory_order_relaxed) != 0) {
+        return;
+      }
+      size_t offset = k * chunk;
+      size_t len = std::min(chunk, size - offset);
+      buffer.resize(chunk);
+      if (buffer.data() == nullptr) {
+        write_errno = ENOMEM;
+        return;
+      }
+      crypt(ctx, decrypt, src + offset, buffer.data(), len);
+      if (!pwrite_full(out_fd, buffer.data(), len, (off_t)offset)) {
+        int expected = 0;
+        write_errno.compare_exchange_strong(expected, errno);
+      }
+    });
+
+    if (write_errno != 0) {
+      errno = write_errno;
+      error = errno_message(out);
+      ok = false;
+    }
+    munmap(map, size);
+  }
+
+  if (close(out_fd) != 0 && ok) {
+    error = errno_message(out);
+    ok = false;
+  }
+  close(in_fd);
+  bytes = ok ? size : 0;
+  return ok;
+}
+
+bool ksa_crypt_stream(const KsaContext &ctx, bool decrypt, int in_fd,
+                      int out_fd, ThreadPool &pool, size_t buffer_size,
+                      uint64_t &bytes, std::string &error) {
+  struct Slot {
+    AlignedBuffer data;
+    size_t len = 0;
+    bool filled = false;
+  };
+  Slot slots[2];
+  for (Slot &slot : slots) {
+    slot.data.resize(buffer_size);
+    if (slot.data.data() == nullptr) {
+      error = "out of memory";
+      return false;
+    }
+  }
+
+  // Wakes the reader if it is blocked reading when the writer gives up
+  const int stop_fd = eventfd(0, EFD_CLOEXEC);
+  if (stop_fd < 0) {
+    error = errno_message("eventfd");
+    return false;
+  }
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  bool stop = false;
+  int read_errno = 0;
+
+  // The reader fills slots in turn; a slot with len 0 marks the end of input
+  std::thread reader([&] {
+    for (size_t k = 0;; k++) {
+      Slot &slot = slots[k % 2];
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return stop || !slot.filled; });
+        if (stop) {
+          return;
+        }
+      }
+      ssize_t n = read_full(in_fd, slot.data.data(), buffer_size, stop_fd);
+      std::lock_guard<std::mutex> lock(mutex);
+      if (n < 0) {
+        read_errno = errno;
+        n = 0;
+      }
+      slot.len = (size_t)n;
+      slot.filled = true;
+      changed.notify_all();
+      if (n == 0) {
+        return;
+      }
+    }
+  });
+
+  bool ok = true;
+  bytes = 0;
+  for (size_t k = 0;; k++) {
+    Slot &slot = slots[k % 2];
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [&] { return slot.filled; });
+      if (read_errno != 0) {
+        errno = read_errno;
+        error = errno_message("read");
+        ok = false;
+      }
+    }
+    if (!ok || slot.len == 0) {
+      break;
+    }
+
+    uint8_t *data = slot.data.data();
+    const size_t len = slot.len;
+    const size_t tasks = (len + STREAM_TASK_SIZE - 1) / STREAM_TASK_SIZE;
+    pool.parallel_for(tasks, [&](size_t t) {
+      size_t offset = t * STREAM_TASK_SIZE;
+      crypt(ctx, decrypt, data + offset, data + offset,
+            std::min(STREAM_TASK_SIZE, len - offset));
+    });
+    if (!write_full(out_fd, data, len)) {
+      error = errno_message("write");
+      ok = false;
+      break;
+    }
+    bytes += len;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    slot.filled = false;
+    changed.notify_all();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+    changed.notify_all();
+  }
+  // Adding 1 to a fresh eventfd cannot fail
+  const uint64_t one = 1;
+  ssize_t woken = write(stop_fd, &one, sizeof(one));
+  (void)woken;
+  reader.join();
+  close(stop_fd);
+  return ok;
+}
+
+int run_crypt(int argc, char *argv[], bool decrypt) {
+  uint64_t key = 0;
+  bool have_key = false;
+  unsigned threads = 0;
+  size_t chunk = KSA_FILE_CHUNK;
+  std::vector<std::string> paths;
+
+  for (int i = 0; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-h" || arg == "--help") {
+      crypt_usage(decrypt);
+      return 0;
+    } else if ((arg == "-k" || arg == "--key") && i + 1 < argc) {
+      have_key = parse_key(argv[++i], key);
+      if (!have_key) {
+        fprintf(stderr, "Error: invalid key %s\n", argv[i]);
+        return 1;
+      }
+    } else if ((arg == "-j" || arg == "--threads") && i + 1 < argc) {
+      threads = (unsigned)std::stoul(argv[++i]);
+    } else if ((arg == "-c" || arg == "--chunk") && i + 1 < argc) {
+      chunk = std::max<size_t>(1, std::stoul(argv[++i])) << 20;
+    } else {
+      paths.push_back(arg);
+    }
+  }
+  if (!have_key || paths.size() != 2) {
+    crypt_usage(decrypt);
+    return 1;
+  }
+
+  KsaContext ctx;
+  generate_sboxes_and_subkeys(key, ctx);
+  ThreadPool pool(threads);
+  const char *what = decrypt ? "decrypt" : "encrypt";
+  const std::string &in = paths[0];
+  const std::string &out = paths[1];
+
+  std::string error;
+  uint64_t bytes = 0;
+  bool ok;
+  auto t0 = std::chrono::steady_clock::now();
+  if (is_regular_file(in) && is_file_output(out)) {
+    ok = ksa_crypt_file(ctx, decrypt, in, out, pool, chunk, bytes, error);
+    if (ok) {
+      report(what, "file", bytes, seconds_since(t0), pool.size());
+    }
+  } else {
+    int in_fd = (in == "-") ? STDIN_FILENO : open(in.c_str(), O_RDONLY | O_CLOEXEC);
+    int out_fd = (out == "-") ? STDOUT_FILENO
+                              : open(out.c_str(),
+                                     O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                                     0644);
+    if (in_fd < 0 || out_fd < 0) {
+      error = errno_message(in_fd < 0 ? in : out);
+      ok = false;
+    } else {
+      ok = ksa_crypt_stream(ctx, decrypt, in_fd, out_fd, pool, chunk, bytes,
+                            error);
+    }
+    if (in_fd > STDIN_FILENO) {
+      close(in_fd);
+    }
+    if (out_fd > STDERR_FILENO && close(out_fd) != 0 && ok) {
+      error = errno_message(out);
+      ok = false;
+    }
+    if (ok) {
+      report(what, "stream", bytes, seconds_since(t0), pool.size());
+    }
+  }
+
+  if (!ok) {
+    fprintf(stderr, "Error: %s\n", error.c_str());
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * Writes a random file, encrypts and decrypts it in file mode and in stream
+ * mode, and checks that the ciphertext matches encrypt_byte() and that both
+ * round trips restore the input.
+ */
+int run_selftest(int argc, char *argv[]) {
+  size_t mb = 64;
+  unsigned threads = 0;
+  const char *env_tmpdir = getenv("TMPDIR");
+  std::string tmpdir =
+      (env_tmpdir != nullptr && *env_tmpdir != '\0') ? env_tmpdir : "/tmp";
+  for (int i = 0; i < argc; i++) {
+    std::string arg = argv[i];
+    if ((arg == "-j" || arg == "--threads") && i + 1 < argc) {
+      threads = (unsigned)std::stoul(argv[++i]);
+    } else if ((arg == "-T" || arg == "--tmpdir") && i + 1 < argc) {
+      tmpdir = argv[++i];
+    } else if (arg == "-h" || arg == "--help") {
+      printf("Usage: KSA-ASX-64_8bit selftest [-j N] [-T DIR] [MB]\n");
+      return 0;
+    } else {
+      mb = std::stoul(arg);
+    }
+  }
+
+  // An odd size exercises the short last chunk and the SIMD tail
+  std::mt19937_64 rng(std::random_device{}());
+  const size_t size = (mb << 20) + 4093;
+  std::vector<uint8_t> plain(size);
+  for (size_t i = 0; i < size; i++) {
+    plain[i] = (uint8_t)rng();
+  }
+  const uint64_t key = rng();
+  KsaContext ctx;
+  generate_sboxes_and_subkeys(key, ctx);
+  ThreadPool pool(threads);
+
+  const std::string base = tmpdir + "/ksa-selftest-" + std::to_string(getpid());
+  const std::string plain_path = base + ".plain";
+  const std::string cipher_path = base + ".enc";
+  const std::string file_path = base + ".dec";
+  const std::string stream_path = base + ".sdec";
+
+  auto read_back = [](const std::string &path, std::vector<uint8_t> &data) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+    data.resize(ok ? (size_t)st.st_size : 0);
+    ok = ok && read_full(fd, data.data(), data.size()) == (ssize_t)data.size();
+    close(fd);
+    return ok;
+  };
+
+  printf("selftest: key 0x%016llX, %zu bytes, %u threads\n",
+         (unsigned long long)key, size, pool.size());
+  fflush(stdout);
+  std::string error;
+  uint64_t bytes = 0;
+  bool ok = true;
+
+  int fd = open(plain_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  ok = fd >= 0 && write_full(fd, plain.data(), size);
+  if (fd >= 0) {
+    close(fd);
+  }
+  if (!ok) {
+    error = errno_message(plain_path);
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  ok = ok && ksa_crypt_file(ctx, false, plain_path, cipher_path, pool,
+                            KSA_FILE_CHUNK, bytes, error);
+  if (ok) {
+    report("encrypt", "file", bytes, seconds_since(t0), pool.size());
+  }
+  t0 = std::chrono::steady_clock::now();
+  ok = ok && ksa_crypt_file(ctx, true, cipher_path, file_path, pool,
+                            KSA_FILE_CHUNK, bytes, error);
+  if (ok) {
+    report("decrypt", "file", bytes, seconds_since(t0), pool.size());
+  }
+
+  if (ok) {
+    int in_fd = open(cipher_path.c_str(), O_RDONLY | O_CLOEXEC);
+    int out_fd =
+        open(stream_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    t0 = std::chrono::steady_clock::now();
+    ok = in_fd >= 0 && out_fd >= 0 &&
+         ksa_crypt_stream(ctx, true, in_fd, out_fd, pool, KSA_FILE_CHUNK, bytes,
+                          error);
+    if (ok) {
+      report("decrypt", "stream", bytes, seconds_since(t0), pool.size());
+    } else if (error.empty()) {
+      error = errno_message(stream_path);
+    }
+    if (in_fd >= 0) {
+      close(in_fd);
+    }
+    if (out_fd >= 0) {
+      close(out_fd);
+    }
+  }
+
+  std::vector<uint8_t> data;
+  bool cipher_ok = false;
+  bool file_ok = false;
+  bool stream_ok = false;
+  if (ok) {
+    cipher_ok = read_back(cipher_path, data) && data.size() == size;
+    for (size_t i = 0; i < size && cipher_ok; i++) {
+      cipher_ok = data[i] == encrypt_byte(ctx, plain[i]);
+    }
+    file_ok = read_back(file_path, data) && data == plain;
+    stream_ok = read_back(stream_path, data) && data == plain;
+    printf("ciphertext matches encrypt_byte: %s\n", cipher_ok ? "OK" : "MISMATCH");
+    printf("file round trip:                 %s\n", file_ok ? "OK" : "MISMATCH");
+    printf("stream round trip:               %s\n", stream_ok ? "OK" : "MISMATCH");
+  }
+
+  unlink(plain_path.c_str());
+  unlink(cipher_path.c_str());
+  unlink(file_path.c_str());
+  unlink(stream_path.c_str());
+
+  if (!ok) {
+    fprintf(stderr, "Error: %s\n", error.c_str());
+    return 1;
+  }
+  return (cipher_ok && file_ok && stream_ok) ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+#ifndef KSA_FILE_H
+#define KSA_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "ksa_cipher.h"
+#include "thread_pool.h"
+
+// Default unit of work for file mode and buffer size for stream mode
+const size_t KSA_FILE_CHUNK = 8 << 20;
+
+/**
+ * @brief Encrypt (or decrypt) a regular file into another file.
+ *
+ * The input is mmapped and split into chunk-sized pieces. The cipher works
+ * byte by byte with no chaining, so every piece is independent: pool tasks
+ * transform them into per-thread aligned buffers and write them to their
+ * own offsets with pwrite().
+ *
+ * @param error Set to a message when false is returned.
+ */
+bool ksa_crypt_file(const KsaContext &ctx, bool decrypt, const std::string &in,
+                    const std::string &out, ThreadPool &pool, size_t chunk,
+                    uint64_t &bytes, std::string &error);
+
+/**
+ * @brief Encrypt (or decrypt) everything read from in_fd and write it to
+ * out_fd, for pipes, stdin and stdout.
+ *
+ * Two aligned buffers of buffer_size bytes alternate: a reader thread fills
+ * one while the other is transformed (split across the pool) and written.
+ */
+bool ksa_crypt_stream(const KsaContext &ctx, bool decrypt, int in_fd,
+                      int out_fd, ThreadPool &pool, size_t buffer_size,
+                      uint64_t &bytes, std::string &error);
+
+// Command line entries: KSA-ASX-64_8bit encrypt|decrypt ... / selftest ...
+int run_crypt(int argc, char *argv[], bool decrypt);
+int run_selftest(int argc, char *argv[]);
+
+#endif // KSA_FILE_H
@@ -0,0 +1,141 @@
+#include "ksa_tables.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+constexpr bool round_trips(const KsaTables &tables) {
+  for (int i = 0; i < 256; i++) {
+    if (decrypt_byte(tables, encrypt_byte(tables, (uint8_t)i)) != i) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Fails the build if the key schedule stops being usable at compile time
+static_assert(round_trips(make_ksa_tables(0x123456789ABCDEF1ULL)),
+              "compile-time KSA tables must round-trip");
+
+bool is_identifier(const std::string &name) {
+  if (name.empty() || isdigit((unsigned char)name[0])) {
+    return false;
+  }
+  for (char c : name) {
+    if (!isalnum((unsigned char)c) && c != '_') {
+      return false;
+    }
+  }
+  return true;
+}
+
+void emit_table(FILE *out, const std::string &name, const char *suffix,
+                const uint8_t *table) {
+  fprintf(out, "static const uint8_t %s_%s[256] KSA_TABLE_ATTR = {\n",
+          name.c_str(), suffix);
+  for (int i = 0; i < 256; i += 16) {
+    fprintf(out, "   ");
+    for (int k = 0; k < 16; k++) {
+      fprintf(out, " 0x%02X,", table[i + k]);
+    }
+    fprintf(out, "\n");
+  }
+  fprintf(out, "};\n");
+}
+
+} // namespace
+
+bool ksa_emit_tables(uint64_t key_64bit, const std::string &name, FILE *out) {
+  const KsaTables tables = make_ksa_tables(key_64bit);
+  std::string guard;
+  for (char c : name) {
+    guard += (char)toupper((unsigned char)c);
+  }
+  guard += "_KSA_TABLES_H";
+  const char *n = name.c_str();
+
+  // The key itself is left out of the output on purpose
+  fprintf(out, "/* Generated by `KSA-ASX-64_8bit emit-tables`; do not edit.\n");
+  fprintf(out, " *\n");
+  fprintf(out, " * Fused KSA cipher tables of one fixed key: %s_enc_table[A] "
+               "folds the\n",
+          n);
+  fprintf(out, " * modular addition, S-box lookup and XOR of encrypt_byte(), "
+               "and\n");
+  fprintf(out, " * %s_dec_table the reverse steps. Both are const, so the "
+               "linker places\n",
+          n);
+  fprintf(out, " * them in flash and boot runs no key schedule. Define "
+               "KSA_TABLE_ATTR\n");
+  fprintf(out, " * (e.g. a section attribute) if the toolchain needs one for "
+               "that.\n");
+  fprintf(out, " */\n");
+  fprintf(out, "#ifndef %s\n#define %s\n\n", guard.c_str(), guard.c_str());
+  fprintf(out, "#include <stdint.h>\n\n");
+  fprintf(out, "#ifndef KSA_TABLE_ATTR\n#define KSA_TABLE_ATTR\n#endif\n\n");
+  emit_table(out, name, "enc_table", tables.enc_table);
+  fprintf(out, "\n");
+  emit_table(out, name, "dec_table", tables.dec_table);
+  fprintf(out, "\n");
+  fprintf(out, "static inline uint8_t %s_encrypt_byte(uint8_t data_A) {\n", n);
+  fprintf(out, "  return %s_enc_table[data_A];\n}\n\n", n);
+  fprintf(out, "static inline uint8_t %s_decrypt_byte(uint8_t data_B) {\n", n);
+  fprintf(out, "  return %s_dec_table[data_B];\n}\n\n", n);
+  fprintf(out, "#endif /* %s */\n", guard.c_str());
+  return !ferror(out);
+}
+
+int run_emit_tables(int argc, char *argv[]) {
+  uint64_t key = 0;
+  bool have_key = false;
+  std::string name = "ksa";
+  std::string path = "-";
+  for (int i = 0; i < argc; i++) {
+    std::string arg = argv[i];
+    if ((arg == "-k" || arg == "--key") && i + 1 < argc) {
+      char *end = nullptr;
+      errno = 0;
+      key = strtoull(argv[++i], &end, 0);
+      have_key = errno == 0 && end != argv[i] && *end == '\0';
+      if (!have_key) {
+        fprintf(stderr, "Error: invalid key %s\n", argv[i]);
+        return 1;
+      }
+    } else if ((arg == "-n" || arg == "--name") && i + 1 < argc) {
+      name = argv[++i];
+    } else if ((arg == "-o" || arg == "--output") && i + 1 < argc) {
+      path = argv[++i];
+    } else {
+      have_key = false;
+      break;
+    }
+  }
+  if (!have_key) {
+    printf("Usage: KSA-ASX-64_8bit emit-tables -k KEY [-n NAME] [-o FILE]\n");
+    printf("  Write the fused tables of KEY as a C header (default NAME: ksa, "
+           "FILE: stdout)\n");
+    return 1;
+  }
+  if (!is_identifier(name)) {
+    fprintf(stderr, "Error: %s is not a C identifier\n", name.c_str());
+    return 1;
+  }
+
+  FILE *out = (path == "-") ? stdout : fopen(path.c_str(), "w");
+  if (out == nullptr) {
+    fprintf(stderr, "Error: %s: %s\n", path.c_str(), strerror(errno));
+    return 1;
+  }
+  bool ok = ksa_emit_tables(key, name, out);
+  if (out != stdout) {
+    ok = (fclose(out) == 0) && ok;
+  }
+  if (!ok) {
+    fprintf(stderr, "Error: failed to write %s\n", path.c_str());
+    return 1;
+  }
+  return 0;
+}
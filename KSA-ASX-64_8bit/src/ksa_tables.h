@@ -0,0 +1,61 @@
+#ifndef KSA_TABLES_H
+#define KSA_TABLES_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+#include "ksa_cipher.h"
+
+// Key schedules of fixed keys done before run time, for firmware that must
+// not spend boot time or RAM on generate_sboxes_and_subkeys().
+//
+// C++ code builds the tables at compile time:
+//   static constexpr KsaTables device_tables = make_ksa_tables(0x...ULL);
+//   uint8_t b = encrypt_byte(device_tables, a);
+// C code includes a header written by `KSA-ASX-64_8bit emit-tables`.
+// Either way the tables are const data, which the linker places in flash.
+
+/**
+ * @brief The fused encryption and decryption tables of one key (see
+ * KsaContext); 512 bytes, without the S-boxes and subkeys they fold in.
+ */
+struct KsaTables {
+  uint8_t enc_table[256];
+  uint8_t dec_table[256];
+};
+
+constexpr KsaTables make_ksa_tables(uint64_t key_64bit) {
+  KsaContext ctx{};
+  generate_sboxes_and_subkeys(key_64bit, ctx);
+  KsaTables tables{};
+  for (int i = 0; i < 256; i++) {
+    tables.enc_table[i] = ctx.enc_table[i];
+    tables.dec_table[i] = ctx.dec_table[i];
+  }
+  return tables;
+}
+
+constexpr uint8_t encrypt_byte(const KsaTables &tables, uint8_t data_A) {
+  return tables.enc_table[data_A];
+}
+
+constexpr uint8_t decrypt_byte(const KsaTables &tables, uint8_t data_B) {
+  return tables.dec_table[data_B];
+}
+
+/**
+ * @brief Write a self-contained C header with the fused tables of key as
+ * `static const uint8_t <name>_enc_table[256]` / `<name>_dec_table[256]` and
+ * `<name>_encrypt_byte()` / `<name>_decrypt_byte()`.
+ *
+ * @param name C identifier used as prefix and, upper-cased, as include guard.
+ * @return false if writing to out failed.
+ */
+bool ksa_emit_tables(uint64_t key_64bit, const std::string &name, FILE *out);
+
+// Command line entry: KSA-ASX-64_8bit emit-tables ...
+int run_emit_tables(int argc, char *argv[]);
+
+#endif // KSA_TABLES_H
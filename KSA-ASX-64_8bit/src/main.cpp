@@ -2,6 +2,21 @@
 #include <stdbool.h> // For bool type
 #include <stdint.h>  // For fixed-width integer types: uint64_t, uint8_t
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ksa_analysis.h"
+#include "ksa_batch.h"
+#include "ksa_bench.h"
+#include "ksa_cache.h"
+#include "ksa_cipher.h"
+#include "ksa_file.h"
+#include "ksa_tables.h"
 
 // --- Theoretical Feasibility Assessment Summary ---
 // This approach is theoretically completely feasible. By generating key-related
@@ -10,125 +25,348 @@
 // 8-bit to 8-bit encryption and decryption, while providing good disturbance
 // and avalanche effect.
 
-// Global S-box and inverse S-box. In practical applications, they are usually
-// part of internal state or passed through context. For demonstration
-// simplicity, they are set as global variables here.
-static uint8_t sbox[256];
-static uint8_t inv_sbox[256];
-static uint8_t subkey_add; // Subkey for modular addition
-static uint8_t subkey_xor; // Subkey for XOR operation
+// --- Multi-key thread scaling benchmark ---
 
 /**
- * @brief Generate S-box, inverse S-box and subkeys using a 64-bit key.
+ * @brief Encrypt and decrypt an mb-sized buffer per thread, every thread with
+ * its own key and KsaContext, for 1, 2, 4, ... max_threads threads.
  *
- * This function is based on a simplified version of Key Scheduling Algorithm
- * (KSA), ensuring generation of a key-related permutation of 256 bytes. At the
- * same time, it derives two 8-bit subkeys from the 64-bit master key.
- *
- * @param key_64bit 64-bit key for S-box initialization and confusion, and
- * subkey derivation.
+ * Each thread does the same amount of work, so with linear scaling the wall
+ * time stays flat and the aggregate throughput grows with the thread count.
  */
-void generate_sboxes_and_subkeys(uint64_t key_64bit) {
-  int i, j;
-
-  // 1. Initialize S-box: sbox[i] = i
-  for (i = 0; i < 256; i++) {
-    sbox[i] = i;
+static int bench_threads(unsigned max_threads, size_t mb) {
+  const size_t size = mb << 20;
+  std::vector<KsaContext> contexts(max_threads);
+  std::vector<std::vector<uint8_t>> plain(max_threads);
+  std::vector<std::vector<uint8_t>> cipher(max_threads);
+  std::mt19937_64 rng(12345);
+  for (unsigned t = 0; t < max_threads; t++) {
+    generate_sboxes_and_subkeys(rng(), contexts[t]);
+    plain[t].resize(size);
+    cipher[t].resize(size);
+    for (size_t i = 0; i < size; i++) {
+      plain[t][i] = (uint8_t)rng();
+    }
   }
 
-  // 2. Decompose 64-bit key into 8 8-bit bytes for S-box confusion and subkey
-  // derivation
-  uint8_t k_bytes[8];
-  for (i = 0; i < 8; i++) {
-    k_bytes[i] = (uint8_t)((key_64bit >> (i * 8)) & 0xFF);
+  // Returns false if the round trip of thread t does not restore its input
+  auto worker = [&](unsigned t) {
+    const KsaContext &ctx = contexts[t];
+    uint8_t *in = plain[t].data();
+    uint8_t *out = cipher[t].data();
+    for (size_t i = 0; i < size; i++) {
+      out[i] = encrypt_byte(ctx, in[i]);
+    }
+    bool ok = true;
+    for (size_t i = 0; i < size; i++) {
+      ok &= (decrypt_byte(ctx, out[i]) == in[i]);
+    }
+    return ok;
+  };
+
+  printf("%zu MB per thread, one key per thread, encrypt + decrypt\n", mb);
+  double base = 0;
+  bool all_ok = true;
+  for (unsigned threads = 1;; threads = std::min(threads * 2, max_threads)) {
+    double best = 1e30;
+    bool ok = true;
+    for (int r = 0; r < 3; r++) {
+      std::vector<char> results(threads, 0);
+      auto t0 = std::chrono::steady_clock::now();
+      std::vector<std::thread> pool;
+      for (unsigned t = 1; t < threads; t++) {
+        pool.emplace_back([&, t] { results[t] = worker(t); });
+      }
+      results[0] = worker(0);
+      for (auto &th : pool) {
+        th.join();
+      }
+      auto t1 = std::chrono::steady_clock::now();
+      best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+      for (char res : results) {
+        ok = ok && res;
+      }
+    }
+    // Two passes (encrypt and decrypt) over every thread's buffer
+    double mb_per_sec = 2.0 * mb * threads / best;
+    if (threads == 1) {
+      base = mb_per_sec;
+    }
+    all_ok = all_ok && ok;
+    printf("%3u threads %10.1f MB/s  x%.2f  %s\n", threads, mb_per_sec,
+           mb_per_sec / base, ok ? "OK" : "MISMATCH");
+    if (threads == max_threads) {
+      break;
+    }
   }
+  return all_ok ? 0 : 1;
+}
 
-  // 3. KSA-like confusion process: shuffle S-box according to key
-  // This is a key step to ensure permutation generation, similar to RC4's KSA.
-  j = 0;
-  for (i = 0; i < 256; i++) {
-    j = (j + sbox[i] + k_bytes[i % 8]) %
-        256; // Introduce confusion of key bytes and current S-box state
-    // Swap sbox[i] and sbox[j]
-    uint8_t temp = sbox[i];
-    sbox[i] = sbox[j];
-    sbox[j] = temp;
-  }
+// --- Buffer encrypt/decrypt benchmark ---
 
-  // 4. Generate inverse S-box
-  // If sbox[x] = y, then inv_sbox[y] = x
-  for (i = 0; i < 256; i++) {
-    inv_sbox[sbox[i]] = i;
+/**
+ * @brief Compare encrypt_buffer/decrypt_buffer implementations against the
+ * byte-at-a-time path on an mb-sized random buffer.
+ *
+ * Every implementation must produce exactly the encrypt_byte output and must
+ * round-trip; sizes 0..300 are checked as well to cover the tail handling.
+ */
+static int bench_buffer(size_t mb) {
+  const size_t size = mb << 20;
+  const int rounds = 5;
+  KsaContext ctx;
+  generate_sboxes_and_subkeys(0x123456789ABCDEF1ULL, ctx);
+
+  std::vector<uint8_t> plain(size);
+  std::mt19937_64 rng(12345);
+  for (size_t i = 0; i < size; i++) {
+    plain[i] = (uint8_t)rng();
   }
+  std::vector<uint8_t> expected(size);
+  std::vector<uint8_t> cipher(size);
+  std::vector<uint8_t> restored(size);
+
+  auto seconds_of = [&](auto &&fn) {
+    double best = 1e30;
+    for (int r = 0; r < rounds; r++) {
+      auto t0 = std::chrono::steady_clock::now();
+      fn();
+      auto t1 = std::chrono::steady_clock::now();
+      best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    return best;
+  };
 
-  // 5. Derive subkeys
-  // Here simply use two bytes of the key as subkeys.
-  // More complex derivation methods can provide better security, but sufficient
-  // for 8-bit operations.
-  subkey_add = k_bytes[0]; // Use first byte of key as modular addition subkey
-  subkey_xor = k_bytes[1]; // Use second byte of key as XOR subkey
+  double byte_enc = seconds_of([&] {
+    for (size_t i = 0; i < size; i++) {
+      expected[i] = encrypt_byte(ctx, plain[i]);
+    }
+  });
+  double byte_dec = seconds_of([&] {
+    for (size_t i = 0; i < size; i++) {
+      restored[i] = decrypt_byte(ctx, expected[i]);
+    }
+  });
+  printf("buffer: %zu MB, rounds: %d\n", mb, rounds);
+  printf("%-12s encrypt %9.1f MB/s   decrypt %9.1f MB/s\n", "byte", mb / byte_enc,
+         mb / byte_dec);
+
+  const KsaBufferImpl impls[] = {
+      KsaBufferImpl::Scalar, KsaBufferImpl::Ssse3, KsaBufferImpl::Avx2,
+      KsaBufferImpl::Avx512Vbmi, KsaBufferImpl::Auto,
+  };
+  bool all_ok = true;
+  for (KsaBufferImpl impl : impls) {
+    if (!ksa_buffer_supported(impl)) {
+      printf("%-12s not supported on this CPU\n", ksa_buffer_impl_name(impl));
+      continue;
+    }
 
-  printf(
-      "S-box, inverse S-box and subkeys generated (based on key: 0x%016llX).\n",key_64bit);
-  printf("  Subkey (addition): 0x%02X, Subkey (XOR): 0x%02X\n", subkey_add,
-         subkey_xor);
+    double enc = seconds_of(
+        [&] { encrypt_buffer(ctx, plain.data(), cipher.data(), size, impl); });
+    double dec = seconds_of([&] {
+      decrypt_buffer(ctx, cipher.data(), restored.data(), size, impl);
+    });
+    bool ok = (cipher == expected) && (restored == plain);
+
+    // Short buffers at every length and alignment up to 300 bytes
+    for (size_t len = 0; len <= 300 && ok; len++) {
+      size_t offset = len % 61;
+      encrypt_buffer(ctx, plain.data() + offset, cipher.data(), len, impl);
+      decrypt_buffer(ctx, cipher.data(), restored.data(), len, impl);
+      for (size_t i = 0; i < len; i++) {
+        ok = ok && cipher[i] == expected[offset + i] &&
+             restored[i] == plain[offset + i];
+      }
+    }
+
+    all_ok = all_ok && ok;
+    printf("%-12s encrypt %9.1f MB/s   decrypt %9.1f MB/s   x%.2f  %s\n",
+           ksa_buffer_impl_name(impl), mb / enc, mb / dec, byte_enc / enc,
+           ok ? "OK" : "MISMATCH");
+  }
+  return all_ok ? 0 : 1;
 }
 
+// --- Key context cache benchmark ---
+
 /**
- * @brief Encryption function: encrypt 8-bit data A into 8-bit data B, adding
- * disturbance and avalanche effect.
- *
- * Encryption process: (A + subkey_add) % 256 -> S-box lookup -> result XOR
- * subkey_xor
+ * @brief Encrypt a 64-byte record for each of `lookups` requests spread over
+ * `keys` device keys, once rebuilding the key schedule for every request and
+ * once through a KsaContextCache of `capacity` entries.
  *
- * @param data_A Original 8-bit data.
- * @return Encrypted 8-bit data B.
+ * Requests are skewed toward a hot set of keys (index = keys * u^2 for a
+ * uniform u), as when a gateway serves a few busy devices and many idle ones.
  */
-uint8_t encrypt_byte(uint8_t data_A) {
-  // Step 1: Modular addition with addition subkey, providing initial
-  // disturbance
-  uint8_t intermediate1 = (data_A + subkey_add) % 256;
-
-  // Step 2: Non-linear permutation through S-box
-  uint8_t intermediate2 = sbox[intermediate1];
-
-  // Step 3: XOR with XOR subkey for further confusion
-  uint8_t data_B = intermediate2 ^ subkey_xor;
+static int bench_cache(size_t keys, size_t capacity, size_t lookups) {
+  std::mt19937_64 rng(12345);
+  std::vector<uint64_t> device_keys(keys);
+  for (auto &key : device_keys) {
+    key = rng();
+  }
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  std::vector<uint32_t> requests(lookups);
+  for (auto &r : requests) {
+    double u = uniform(rng);
+    r = std::min<uint32_t>((uint32_t)(keys * u * u), (uint32_t)keys - 1);
+  }
 
-  // printf("[Encrypt] A: 0x%02X -> B: 0x%02X (intermediate1: 0x%02X,
-  // intermediate2: 0x%02X)\n",
-  //        data_A, data_B, intermediate1, intermediate2);
-  return data_B;
+  uint8_t record[64];
+  for (size_t i = 0; i < sizeof(record); i++) {
+    record[i] = (uint8_t)i;
+  }
+  uint8_t out[64];
+
+  auto t0 = std::chrono::steady_clock::now();
+  uint64_t plain_sum = 0;
+  KsaContext ctx;
+  for (uint32_t r : requests) {
+    generate_sboxes_and_subkeys(device_keys[r], ctx);
+    encrypt_buffer(ctx, record, out, sizeof(out));
+    plain_sum += out[r % sizeof(out)];
+  }
+  double uncached = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - t0)
+                        .count();
+
+  KsaContextCache cache(capacity);
+  t0 = std::chrono::steady_clock::now();
+  uint64_t cached_sum = 0;
+  for (uint32_t r : requests) {
+    std::shared_ptr<const KsaContext> c = cache.get(device_keys[r]);
+    encrypt_buffer(*c, record, out, sizeof(out));
+    cached_sum += out[r % sizeof(out)];
+  }
+  double cached = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - t0)
+                      .count();
+
+  KsaCacheStats stats = cache.stats();
+  bool ok = (plain_sum == cached_sum);
+  printf("keys: %zu, cache capacity: %zu, requests: %zu\n", keys, capacity,
+         lookups);
+  printf("%-10s %10.2f Mreq/s\n", "no cache", lookups / uncached / 1e6);
+  printf("%-10s %10.2f Mreq/s  x%.2f  %s\n", "LRU cache", lookups / cached / 1e6,
+         uncached / cached, ok ? "OK" : "MISMATCH");
+  printf("hit rate %.2f%% (%llu hits, %llu misses, %llu evictions)\n",
+         100.0 * stats.hit_rate(), (unsigned long long)stats.hits,
+         (unsigned long long)stats.misses, (unsigned long long)stats.evictions);
+  printf("key setup latency: avg %.0f ns, max %llu ns\n", stats.avg_setup_ns(),
+         (unsigned long long)stats.setup_ns_max);
+  return ok ? 0 : 1;
 }
 
+// --- Batch key-schedule benchmark ---
+
 /**
- * @brief Decryption function: decrypt 8-bit data B back to 8-bit data A,
- * reverse of encryption process.
- *
- * Decryption process: B XOR subkey_xor -> inverse S-box lookup -> (result -
- * subkey_add + 256) % 256
- *
- * @param data_B Encrypted 8-bit data.
- * @return Restored original 8-bit data A.
+ * @brief Build the contexts of `count` random keys with
+ * generate_key_schedules() on pools of 1, 4 and all hardware threads, and
+ * compare every context against a serial per-key loop.
  */
-uint8_t decrypt_byte(uint8_t data_B) {
-  // Step 1 (reverse): Restore XOR operation
-  uint8_t intermediate1_inv = data_B ^ subkey_xor;
-
-  // Step 2 (reverse): Restore S-box lookup
-  uint8_t intermediate2_inv = inv_sbox[intermediate1_inv];
+static int bench_keys(size_t count) {
+  std::mt19937_64 rng(12345);
+  std::vector<uint64_t> keys(count);
+  for (auto &key : keys) {
+    key = rng();
+  }
+  std::vector<KsaContext> expected(count);
+  std::vector<KsaContext> ctxs(count);
 
-  // Step 3 (reverse): Restore modular addition (note negative case, add 256 to
-  // ensure positive then modulo)
-  uint8_t data_A_restored = (intermediate2_inv - subkey_add + 256) % 256;
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < count; i++) {
+    generate_sboxes_and_subkeys(keys[i], expected[i]);
+  }
+  double serial = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - t0)
+                      .count();
+  printf("keys: %zu, context size: %zu bytes\n", count, sizeof(KsaContext));
+  printf("%-16s %10.2f Mkeys/s  %7.0f ns/key\n", "serial loop",
+         count / serial / 1e6, serial * 1e9 / count);
+
+  std::vector<unsigned> thread_counts = {1, 4,
+                                         std::thread::hardware_concurrency()};
+  std::sort(thread_counts.begin(), thread_counts.end());
+  thread_counts.erase(std::unique(thread_counts.begin(), thread_counts.end()),
+                      thread_counts.end());
+
+  bool all_ok = true;
+  for (unsigned threads : thread_counts) {
+    if (threads == 0) {
+      continue;
+    }
+    ThreadPool pool(threads);
+    double best = 1e30;
+    for (int r = 0; r < 3; r++) {
+      t0 = std::chrono::steady_clock::now();
+      generate_key_schedules(keys.data(), count, ctxs.data(), pool);
+      best = std::min(best, std::chrono::duration<double>(
+                                std::chrono::steady_clock::now() - t0)
+                                .count());
+    }
+    bool ok = memcmp(ctxs.data(), expected.data(),
+                     count * sizeof(KsaContext)) == 0;
+    all_ok = all_ok && ok;
+    char label[32];
+    snprintf(label, sizeof(label), "pool %u thr", threads);
+    printf("%-16s %10.2f Mkeys/s  %7.0f ns/key  x%.2f  %s\n", label,
+           count / best / 1e6, best * 1e9 / count, serial / best,
+           ok ? "OK" : "MISMATCH");
+  }
+  return all_ok ? 0 : 1;
+}
 
-  // printf("[Decrypt] B: 0x%02X -> A': 0x%02X (intermediate1_inv: 0x%02X,
-  // intermediate2_inv: 0x%02X)\n",
-  //        data_B, data_A_restored, intermediate1_inv, intermediate2_inv);
-  return data_A_restored;
+static void usage() {
+  printf("Usage:\n");
+  printf("  KSA-ASX-64_8bit                           run the demo\n");
+  printf("  KSA-ASX-64_8bit bench-threads [N] [MB]    N threads with N keys, MB per thread\n");
+  printf("  KSA-ASX-64_8bit bench-buffer [MB]         encrypt_buffer/decrypt_buffer per SIMD path\n");
+  printf("  KSA-ASX-64_8bit bench-cache [K] [C] [N]   N requests over K keys, LRU cache of C contexts\n");
+  printf("  KSA-ASX-64_8bit bench-keys [N]            batch key setup of N keys at 1, 4 and all cores\n");
+  printf("  KSA-ASX-64_8bit bench-json [-o FILE]     key setup and throughput as JSON (make bench)\n");
+  printf("  KSA-ASX-64_8bit analyze [N]               S-box quality and key avalanche over N keys\n");
+  printf("  KSA-ASX-64_8bit encrypt -k KEY <in> <out> encrypt a file or stream (\"-\" = stdin/stdout)\n");
+  printf("  KSA-ASX-64_8bit decrypt -k KEY <in> <out> decrypt a file or stream\n");
+  printf("  KSA-ASX-64_8bit emit-tables -k KEY       C header with the const fused tables of KEY\n");
+  printf("  KSA-ASX-64_8bit selftest [MB]             file and stream round trip through a temp file\n");
 }
 
-int main() {
+int main(int argc, char *argv[]) {
+  if (argc > 1) {
+    std::string cmd = argv[1];
+    if (cmd == "-h" || cmd == "--help") {
+      usage();
+      return 0;
+    } else if (cmd == "bench-threads") {
+      unsigned max_threads = (argc > 2) ? (unsigned)std::stoul(argv[2])
+                                        : std::thread::hardware_concurrency();
+      size_t mb = (argc > 3) ? std::stoul(argv[3]) : 64;
+      return bench_threads(std::max(1u, max_threads), std::max<size_t>(1, mb));
+    } else if (cmd == "bench-buffer") {
+      size_t mb = (argc > 2) ? std::stoul(argv[2]) : 256;
+      return bench_buffer(std::max<size_t>(1, mb));
+    } else if (cmd == "bench-cache") {
+      size_t keys = (argc > 2) ? std::stoul(argv[2]) : 10000;
+      size_t capacity = (argc > 3) ? std::stoul(argv[3]) : 4096;
+      size_t lookups = (argc > 4) ? std::stoul(argv[4]) : 2000000;
+      return bench_cache(std::max<size_t>(1, keys), capacity, lookups);
+    } else if (cmd == "bench-keys") {
+      size_t count = (argc > 2) ? std::stoul(argv[2]) : 1000000;
+      return bench_keys(count);
+    } else if (cmd == "bench-json") {
+      return run_bench_json(argc - 2, argv + 2);
+    } else if (cmd == "analyze") {
+      return run_analysis(argc - 2, argv + 2);
+    } else if (cmd == "encrypt" || cmd == "decrypt") {
+      return run_crypt(argc - 2, argv + 2, cmd == "decrypt");
+    } else if (cmd == "emit-tables") {
+      return run_emit_tables(argc - 2, argv + 2);
+    } else if (cmd == "selftest") {
+      return run_selftest(argc - 2, argv + 2);
+    }
+    usage();
+    return 1;
+  }
+
   uint64_t key1 = 0x123456789ABCDEF1ULL; // Example key 1
   uint64_t key2 = 0xFEDCBA9876543210ULL; // Example key 2 (different key)
   uint64_t key3 =
@@ -0,0 +1,62 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed set of worker threads for data-parallel loops.
+ *
+ * The workers are started once and sleep between jobs, so repeated batches
+ * do not pay thread creation. parallel_for() hands out task indices through
+ * an atomic counter; the calling thread takes part as well.
+ */
+class ThreadPool {
+public:
+  /**
+   * @param threads Total threads including the caller; 0 means all hardware
+   * threads.
+   */
+  explicit ThreadPool(unsigned threads = 0);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Threads that run tasks, including the caller of parallel_for()
+  unsigned size() const { return (unsigned)m_workers.size() + 1; }
+
+  /**
+   * @brief Run fn(i) for every i in [0, count) and return when all are done.
+   *
+   * Calls from several threads are serialized. fn must not call
+   * parallel_for() on the same pool.
+   */
+  void parallel_for(size_t count, const std::function<void(size_t)> &fn);
+
+private:
+  void worker_loop();
+  void run_tasks();
+
+  std::vector<std::thread> m_workers;
+  std::mutex m_job_mutex; // Serializes parallel_for() callers
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+  uint64_t m_generation = 0;
+  bool m_stop = false;
+  unsigned m_active = 0; // Workers still inside the current job
+
+  const std::function<void(size_t)> *m_fn = nullptr;
+  size_t m_count = 0;
+  std::atomic<size_t> m_next{0};
+};
+
+#endif // THREAD_POOL_H
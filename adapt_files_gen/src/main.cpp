@@ -14,6 +14,9 @@
 #include <boost/filesystem.hpp>
 
 #include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 namespace po = boost::program_options;
 namespace fs = boost::filesystem;
@@ -148,18 +151,110 @@ std::string replay_string(std::string in_str, std::string rep, std::string sub)
 	return boost::algorithm::replace_all_copy(in_str, rep, sub);
 }
 
+// 一个待处理的 user_effect_flow_*.c 文件
+struct FlowFile {
+	fs::path path;              // canonical 路径
+	std::string file_name;
+	std::string graphic_name;
+};
+
+// 一个 flow 文件生成的内容，按文件顺序拼接到输出中
+struct FlowFragment {
+	std::string table;          // 写入 roboeffect_adapt.c 的部分
+	std::string declaration;    // 写入 roboeffect_adapt.h 的部分
+	std::string warning;
+};
+
+static void append_device_item(std::string& items, const boost::smatch& match_results)
+{
+	items += fmt::format("\t\t{{\n");
+	items += fmt::format("\t\t\t{},//{}\n", replay_string(match_results[1].str(), " ", ""), "io_id");
+	items += fmt::format("\t\t\t{},//{}\n", replay_string(match_results[3].str(), " ", ""), "width");
+	items += fmt::format("\t\t\t{},//{}\n", replay_string(match_results[4].str(), " ", ""), "channel");
+	items += fmt::format("\t\t\t\"{}\",//{}\n", replay_string(match_results[2].str(), " ", ""), "name");
+	items += fmt::format("\t\t}},\n");
+}
+
+// 解析一个 flow 文件。只读取全局的正则和模板，可以在多个线程中同时调用
+static FlowFragment parse_flow_file(const FlowFile& flow)
+{
+	FlowFragment fragment;
+	fragment.table += fmt::format("#include \"{}\"\n", replay_string(flow.file_name, ".c", ".h"));
+	fragment.table += fmt::format(template_device_table, flow.graphic_name);
+	fragment.declaration = fmt::format(template_device_table_declare, flow.graphic_name);
+
+	std::ifstream file_input(flow.path.string());
+	if (!file_input.is_open()) {
+		fragment.warning = fmt::format("Warning: Could not open file {}. Skipping.\n", flow.path.generic_string());
+		return fragment;
+	}
+
+	std::string items;
+	int items_counter = 0;
+	boost::smatch match_results;
+	std::string line;
+	while(std::getline(file_input, line))
+	{
+		// 兼容性修复：在进行正则匹配前，清理行尾的 \r 和其他空白
+		std::string trimmed_line = trim_whitespace(line);
+
+		if (boost::regex_match(trimmed_line, match_results, re_flow_source_item))
+		{
+			append_device_item(items, match_results);
+			items_counter ++;
+		}
+
+		if (boost::regex_match(trimmed_line, match_results, re_flow_sink_item))
+		{
+			append_device_item(items, match_results);
+			items_counter ++;
+		}
+	}
+
+	fragment.table += fmt::format("\t{},\n", items_counter);
+	fragment.table += fmt::format("\t{{\n{}\t}}\n", items);
+	fragment.table += fmt::format("\n}};\n\n");
+	return fragment;
+}
+
+// 用 jobs 个线程解析所有 flow 文件，结果与 flows 一一对应，与线程数无关
+static std::vector<FlowFragment> parse_flow_files(const std::vector<FlowFile>& flows, unsigned jobs)
+{
+	std::vector<FlowFragment> fragments(flows.size());
+	std::atomic<size_t> next{0};
+	auto worker = [&]() {
+		for (size_t i = next.fetch_add(1); i < flows.size(); i = next.fetch_add(1)) {
+			fragments[i] = parse_flow_file(flows[i]);
+		}
+	};
+
+	jobs = static_cast<unsigned>(std::min<size_t>(std::max(1u, jobs), flows.size()));
+	std::vector<std::thread> pool;
+	for (unsigned t = 1; t < jobs; ++t) {
+		pool.emplace_back(worker);
+	}
+	worker();
+	for (std::thread& t : pool) {
+		t.join();
+	}
+	return fragments;
+}
+
 int main(int argc, char** argv) {
 
 
 	fmt::print("adapt files generater, ver=1.2 (Linux compatible)\n");
 
+	unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+
 	/* 检查命令行参数 */
     try {
         po::options_description desc("Options");
         desc.add_options()
             ("help,h", "show help informations")
             ("inputdir,i", po::value<std::string>(), "input processing folder")
-            ("output,o", po::value<std::string>(), "output processing folder");
+            ("output,o", po::value<std::string>(), "output processing folder")
+            ("jobs,j", po::value<unsigned>(), "parallel parsing threads (default: hardware threads, 1: serial)");
 
         po::variables_map vm;
         po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -178,6 +273,10 @@ int main(int argc, char** argv) {
 			output_dir = vm["output"].as<std::string>();
         }
 
+        if (vm.count("jobs")) {
+			jobs = vm["jobs"].as<unsigned>();
+        }
+
 
     } catch(const po::error &ex) {
         fmt::print(stderr, "Error: {}\n", ex.what());
@@ -204,6 +303,7 @@ int main(int argc, char** argv) {
 
 	if (fs::exists(absolute_input_dir) && fs::is_directory(absolute_input_dir))
 	{
+		std::vector<FlowFile> flows;
 		for (auto& entry : fs::recursive_directory_iterator(absolute_input_dir))
 		{
 			if(fs::is_regular_file(entry.path()))
@@ -212,63 +312,27 @@ int main(int argc, char** argv) {
 
 				boost::smatch match_results;
 				if (boost::regex_match(file_name, match_results, re_flow_c_file)) {
-					fs::path absolute_path = fs::canonical(entry.path());
-					fmt::print("Processing: {}\n", absolute_path.generic_string());
-
-					std::string graphic_name = match_results[1].str();
-
-					api_c_file << fmt::format("#include \"{}\"\n", replay_string(file_name, ".c", ".h"));
-					api_c_file << fmt::format(template_device_table, graphic_name);
-
-					declaration_str += fmt::format(template_device_table_declare, graphic_name);
-
-					std::string items;
-					int items_counter = 0;
-
-					std::ifstream file_input(absolute_path.string());
-					if (!file_input.is_open()) {
-                        fmt::print(stderr, "Warning: Could not open file {}. Skipping.\n", absolute_path.generic_string());
-                        continue;
-                    }
-
-					std::string line;
-					while(std::getline(file_input, line))
-					{
-                        // 兼容性修复：在进行正则匹配前，清理行尾的 \r 和其他空白
-                        std::string trimmed_line = trim_whitespace(line);
-                        
-						if (boost::regex_match(trimmed_line, match_results, re_flow_source_item))
-						{
-							// fmt::print("Match source: {}\n", match_results[1].str());
-							items += fmt::format("\t\t{{\n");
-							items += fmt::format("\t\t\t{},//{}\n", replay_string(match_results[1].str(), " ", ""), "io_id");
-							items += fmt::format("\t\t\t{},//{}\n", replay_string(match_results[3].str(), " ", ""), "width");
-							items += fmt::format("\t\t\t{},//{}\n", replay_string(match_results[4].str(), " ", ""), "channel");
-							items += fmt::format("\t\t\t\"{}\",//{}\n", replay_string(match_results[2].str(), " ", ""), "name");
-							items += fmt::format("\t\t}},\n");
-							items_counter ++;
-						}
-
-						if (boost::regex_match(trimmed_line, match_results, re_flow_sink_item))
-						{
-							// fmt::print("Match sink: {}\n", match_results[1].str());
-							items += fmt::format("\t\t{{\n");
-							items += fmt::format("\t\t\t{},//{}\n", replay_string(match_results[1].str(), " ", ""), "io_id");
-							items += fmt::format("\t\t\t{},//{}\n", replay_string(match_results[3].str(), " ", ""), "width");
-							items += fmt::format("\t\t\t{},//{}\n", replay_string(match_results[4].str(), " ", ""), "channel");
-							items += fmt::format("\t\t\t\"{}\",//{}\n", replay_string(match_results[2].str(), " ", ""), "name");
-							items += fmt::format("\t\t}},\n");
-							items_counter ++;
-						}
-					}
-                    file_input.close();
-
-					api_c_file << fmt::format("\t{},\n", items_counter);
-					api_c_file << fmt::format("\t{{\n{}\t}}\n", items);
-					api_c_file << fmt::format("\n}};\n\n");
+					flows.push_back({fs::canonical(entry.path()), file_name, match_results[1].str()});
 				}
 			}
 		}
+
+		// 目录遍历的顺序由文件系统决定，按路径排序后输出才是确定的
+		std::sort(flows.begin(), flows.end(), [](const FlowFile& a, const FlowFile& b) {
+			return a.path.generic_string() < b.path.generic_string();
+		});
+		for (const FlowFile& flow : flows) {
+			fmt::print("Processing: {}\n", flow.path.generic_string());
+		}
+
+		// 各文件并行解析成独立的片段，再按排序后的顺序拼接
+		for (const FlowFragment& fragment : parse_flow_files(flows, jobs)) {
+			if (!fragment.warning.empty()) {
+				fmt::print(stderr, "{}", fragment.warning);
+			}
+			api_c_file << fragment.table;
+			declaration_str += fragment.declaration;
+		}
 	} else {
         fmt::print(stderr, "Error: Input directory '{}' does not exist or is not a directory.\n", input_dir);
         return 1;
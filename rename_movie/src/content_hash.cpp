@@ -0,0 +1,310 @@
+#include "content_hash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t read64(const unsigned char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t read32(const unsigned char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t round64(uint64_t acc, uint64_t input) {
+    acc += input * PRIME2;
+    acc = rotl(acc, 31);
+    return acc * PRIME1;
+}
+
+inline uint64_t merge_round(uint64_t acc, uint64_t val) {
+    acc ^= round64(0, val);
+    return acc * PRIME1 + PRIME4;
+}
+
+// 打开文件的 RAII 包装
+class FileHandle {
+public:
+    FileHandle(const fs::path& path, std::error_code& ec, uint64_t& syscalls)
+        : m_fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC)), m_syscalls(syscalls) {
+        ++m_syscalls;
+        if (m_fd < 0) {
+            ec.assign(errno, std::generic_category());
+        }
+    }
+    ~FileHandle() {
+        if (m_fd >= 0) {
+            ++m_syscalls;
+            ::close(m_fd);
+        }
+    }
+    FileHandle(const FileHandle&) = delete;
+    FileHandle& operator=(const FileHandle&) = delete;
+
+    int fd() const { return m_fd; }
+
+private:
+    int m_fd;
+    uint64_t& m_syscalls;
+};
+
+// 读满 len 字节 (pread 可能只返回一部分)
+bool pread_full(int fd, unsigned char* buf, size_t len, off_t offset, std::error_code& ec, uint64_t& syscalls) {
+    while (len > 0) {
+        ++syscalls;
+        ssize_t n = ::pread(fd, buf, len, offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ec.assign(errno, std::generic_category());
+            return false;
+        }
+        if (n == 0) {
+            // 文件在快照之后被截断
+            ec = std::make_error_code(std::errc::io_error);
+            return false;
+        }
+        buf += n;
+        len -= static_cast<size_t>(n);
+        offset += n;
+    }
+    return true;
+}
+
+} // namespace
+
+uint64_t hash64(const void* data, size_t len, uint64_t seed) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* const end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        uint64_t v1 = seed + PRIME1 + PRIME2;
+        uint64_t v2 = seed + PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME1;
+        const unsigned char* const limit = end - 32;
+        do {
+            v1 = round64(v1, read64(p));
+            v2 = round64(v2, read64(p + 8));
+            v3 = round64(v3, read64(p + 16));
+            v4 = round64(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge_round(h, v1);
+        h = merge_round(h, v2);
+        h = merge_round(h, v3);
+        h = merge_round(h, v4);
+    } else {
+        h = seed + PRIME5;
+    }
+    h += static_cast<uint64_t>(len);
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= round64(0, read64(p));
+        h = rotl(h, 27) * PRIME1 + PRIME4;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<uint64_t>(read32(p)) * PRIME1;
+        h = rotl(h, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        h ^= (*p) * PRIME5;
+        h = rotl(h, 11) * PRIME1;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t sampled_hash(const fs::path& path, uintmax_t size, std::error_code& ec, uint64_t& syscalls) {
+    ec.clear();
+    FileHandle file(path, ec, syscalls);
+    if (ec) {
+        return 0;
+    }
+    // 只读 3 个块，关闭预读以免内核为每个块额外读入上百 KB
+    ++syscalls;
+    ::posix_fadvise(file.fd(), 0, 0, POSIX_FADV_RANDOM);
+
+    std::vector<unsigned char> buf;
+    if (size <= 3 * SAMPLE_BLOCK) {
+        buf.resize(static_cast<size_t>(size));
+        if (!pread_full(file.fd(), buf.data(), buf.size(), 0, ec, syscalls)) {
+            return 0;
+        }
+    } else {
+        buf.resize(3 * SAMPLE_BLOCK);
+        const uintmax_t offsets[3] = {0, (size - SAMPLE_BLOCK) / 2, size - SAMPLE_BLOCK};
+        for (int i = 0; i < 3; ++i) {
+            if (!pread_full(file.fd(), buf.data() + i * SAMPLE_BLOCK, SAMPLE_BLOCK,
+                            static_cast<off_t>(offsets[i]), ec, syscalls)) {
+                return 0;
+            }
+        }
+    }
+    return hash64(buf.data(), buf.size(), size);
+}
+
+uint64_t full_hash(const fs::path& path, uintmax_t size, unsigned threads, std::error_code& ec,
+                   uint64_t& syscalls) {
+    ec.clear();
+    if (size == 0) {
+        return hash64(nullptr, 0, 0);
+    }
+    FileHandle file(path, ec, syscalls);
+    if (ec) {
+        return 0;
+    }
+    // 快照之后文件可能被截断，映射超出文件末尾的部分在读取时会触发 SIGBUS
+    struct stat st;
+    ++syscalls;
+    if (::fstat(file.fd(), &st) != 0) {
+        ec.assign(errno, std::generic_category());
+        return 0;
+    }
+    if (static_cast<uintmax_t>(st.st_size) != size) {
+        ec = std::make_error_code(std::errc::io_error);
+        return 0;
+    }
+    ++syscalls;
+    void* map = ::mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_PRIVATE, file.fd(), 0);
+    if (map == MAP_FAILED) {
+        ec.assign(errno, std::generic_category());
+        return 0;
+    }
+    // 每个线程顺序读自己的块，让内核加大预读
+    ++syscalls;
+    ::madvise(map, static_cast<size_t>(size), MADV_SEQUENTIAL);
+    const unsigned char* data = static_cast<const unsigned char*>(map);
+
+    const size_t chunks = static_cast<size_t>((size + FULL_HASH_CHUNK - 1) / FULL_HASH_CHUNK);
+    std::vector<uint64_t> digests(chunks);
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t c = next.fetch_add(1); c < chunks; c = next.fetch_add(1)) {
+            size_t offset = c * FULL_HASH_CHUNK;
+            size_t len = std::min<size_t>(FULL_HASH_CHUNK, static_cast<size_t>(size) - offset);
+            digests[c] = hash64(data + offset, len, c);
+            // 已哈希的部分不再需要，尽早释放页缓存压力
+            ::madvise(const_cast<unsigned char*>(data) + offset, len, MADV_DONTNEED);
+        }
+    };
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<size_t>(threads, chunks));
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& t : pool) {
+        t.join();
+    }
+    ::munmap(map, static_cast<size_t>(size));
+    // mmap/madvise 之后：每块一次 madvise(MADV_DONTNEED)，一次 munmap
+    syscalls += chunks + 1;
+
+    // 按块顺序合并，与线程数无关
+    return hash64(digests.data(), digests.size() * sizeof(uint64_t), size);
+}
+
+DuplicateChecker::DuplicateChecker(DedupOptions options) : m_options(options) {}
+
+bool DuplicateChecker::sample(const fs::path& path, uintmax_t size, Hashes& h) {
+    if (!h.sampled && !h.failed) {
+        std::error_code ec;
+        h.sample = sampled_hash(path, size, ec, m_stats.syscalls);
+        if (ec) {
+            h.failed = true;
+        } else {
+            h.sampled = true;
+            ++m_stats.sampled;
+            m_stats.bytes_read += std::min<uintmax_t>(size, 3 * SAMPLE_BLOCK);
+        }
+    }
+    return h.sampled;
+}
+
+bool DuplicateChecker::whole(const fs::path& path, uintmax_t size, Hashes& h) {
+    if (!h.full && !h.failed) {
+        std::error_code ec;
+        h.whole = full_hash(path, size, m_options.threads, ec, m_stats.syscalls);
+        if (ec) {
+            h.failed = true;
+        } else {
+            h.full = true;
+            ++m_stats.full_hashed;
+            m_stats.bytes_read += size;
+        }
+    }
+    return h.full;
+}
+
+void DuplicateChecker::remember(const fs::path& path, uint64_t sample) {
+    Hashes& h = m_cache[path.string()];
+    h.sampled = true;
+    h.sample = sample;
+}
+
+bool DuplicateChecker::known_sample(const fs::path& path, uint64_t& sample) const {
+    auto it = m_cache.find(path.string());
+    if (it == m_cache.end() || !it->second.sampled) {
+        return false;
+    }
+    sample = it->second.sample;
+    return true;
+}
+
+bool DuplicateChecker::same_content(const fs::path& a, const fs::path& b, uintmax_t size) {
+    ++m_stats.compared;
+    // 抽样一致不能证明内容相同，不做全量比较时不把大文件当作重复 (不删除)
+    if (!m_options.full_verify && size > 3 * SAMPLE_BLOCK) {
+        return false;
+    }
+    Hashes& ha = m_cache[a.string()];
+    Hashes& hb = m_cache[b.string()];
+    if (!sample(a, size, ha) || !sample(b, size, hb) || ha.sample != hb.sample) {
+        return false;
+    }
+    // 小文件的抽样已覆盖全部内容
+    if (size <= 3 * SAMPLE_BLOCK) {
+        return true;
+    }
+    return whole(a, size, ha) && whole(b, size, hb) && ha.whole == hb.whole;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+
+// 64 位非加密哈希 (xxHash64 的结构)，用于比较文件内容
+uint64_t hash64(const void* data, size_t len, uint64_t seed);
+
+// 抽样哈希每个块的大小；不超过 3 块的文件整个读入，抽样即为全量
+constexpr size_t SAMPLE_BLOCK = 64 * 1024;
+// 全量哈希的分块大小；分块固定，结果与线程数无关
+constexpr size_t FULL_HASH_CHUNK = 64 * 1024 * 1024;
+
+/**
+ * @brief 抽样哈希：文件开头、中间、结尾各 SAMPLE_BLOCK 字节，加上文件大小。
+ *
+ * 读之前用 posix_fadvise(POSIX_FADV_RANDOM) 关闭预读，每个文件只有 3 次
+ * pread，与文件大小无关。syscalls 累加本次发出的系统调用次数。
+ */
+uint64_t sampled_hash(const std::filesystem::path& path, uintmax_t size, std::error_code& ec, uint64_t& syscalls);
+
+/**
+ * @brief 全量哈希：mmap 整个文件，按 FULL_HASH_CHUNK 分块由 threads 个线程并行
+ * 计算，再按块顺序合并。文件当前大小与 size 不同 (例如仍在下载) 时设置 ec，
+ * 不会读到文件末尾之外 (SIGBUS)。
+ */
+uint64_t full_hash(const std::filesystem::path& path, uintmax_t size, unsigned threads, std::error_code& ec,
+                   uint64_t& syscalls);
+
+struct DedupOptions {
+    bool full_verify = false;  // 抽样一致后再比较全量哈希；关闭时大文件不会被判为重复
+    unsigned threads = 0;      // 全量哈希线程数，0 表示硬件线程数
+};
+
+struct DedupStats {
+    uint64_t compared = 0;      // 大小相同、需要比较内容的文件对
+    uint64_t sampled = 0;       // 计算过抽样哈希的文件
+    uint64_t full_hashed = 0;   // 计算过全量哈希的文件
+    uint64_t bytes_read = 0;
+    uint64_t syscalls = 0;      // open/fadvise/pread/mmap/madvise/close 等
+
+    DedupStats& operator+=(const DedupStats& other) {
+        compared += other.compared;
+        sampled += other.sampled;
+        full_hashed += other.full_hashed;
+        bytes_read += other.bytes_read;
+        syscalls += other.syscalls;
+        return *this;
+    }
+};
+
+/**
+ * @brief 分阶段判断两个文件是否重复：大小 -> 抽样哈希 -> 全量哈希。
+ *
+ * 只有前一阶段一致才进入下一阶段；每个文件的哈希只计算一次。抽样哈希只用来
+ * 排除不同的文件：超过 3 个抽样块的文件必须全量哈希一致才算重复，未开启
+ * full_verify 时这样的文件一律视为不重复。读取失败时也视为不重复，调用方会
+ * 改为添加后缀，不会删除文件。
+ */
+class DuplicateChecker {
+public:
+    explicit DuplicateChecker(DedupOptions options);
+
+    // a、b 为两个文件的路径 (可以在不同目录)，size 为两者相同的大小
+    bool same_content(const std::filesystem::path& a, const std::filesystem::path& b, uintmax_t size);
+
+    // 已知的抽样哈希 (例如来自索引)，之后比较时不再读取该文件
+    void remember(const std::filesystem::path& path, uint64_t sample);
+    // 已计算或已知的抽样哈希
+    bool known_sample(const std::filesystem::path& path, uint64_t& sample) const;
+
+    const DedupStats& stats() const { return m_stats; }
+
+private:
+    struct Hashes {
+        bool sampled = false;
+        bool full = false;
+        bool failed = false;
+        uint64_t sample = 0;
+        uint64_t whole = 0;
+    };
+
+    bool sample(const std::filesystem::path& path, uintmax_t size, Hashes& h);
+    bool whole(const std::filesystem::path& path, uintmax_t size, Hashes& h);
+
+    DedupOptions m_options;
+    DedupStats m_stats;
+    std::unordered_map<std::string, Hashes> m_cache;
+};
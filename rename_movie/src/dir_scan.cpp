@@ -0,0 +1,157 @@
+#include "dir_scan.h"
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// getdents64 的缓冲区；网络文件系统上每次调用是一次往返，缓冲区大些调用少
+constexpr size_t DENTS_BUFFER = 256 * 1024;
+
+// 内核 getdents64 返回的目录项格式
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+bool is_dot(const char* name) {
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+int64_t timestamp_ns(const struct statx_timestamp& ts) {
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// 按需要的字段调用 statx，填写 entry 的类型和大小。
+// link 表示已知是符号链接：与 std::filesystem::is_regular_file 一样跟随链接判断
+// 是否为常规文件，但指向目录的链接不算目录 (不递归进入)
+bool statx_entry(int dirfd, const char* path, bool need_type, bool link, DirEntry& entry, FsCounters& counters) {
+    unsigned mask = need_type ? STATX_TYPE : 0;
+    // 已知是常规文件，或类型未知但名字含季集标记 (可能需要大小)
+    const bool candidate = find_episode(entry.name, entry.match);
+    if (candidate) {
+        mask |= STATX_SIZE | STATX_MTIME;
+    }
+    if (mask == 0 || (link && !candidate)) {
+        return true;
+    }
+    struct statx stx;
+    ++counters.stats;
+    int rc = ::statx(dirfd, path, link ? 0 : AT_SYMLINK_NOFOLLOW, mask, &stx);
+    if (rc == 0 && need_type && !link && candidate && S_ISLNK(stx.stx_mode)) {
+        // d_type 未知时 stat 之后才知道是符号链接，跟随链接再读一次
+        link = true;
+        ++counters.stats;
+        rc = ::statx(dirfd, path, 0, mask, &stx);
+    }
+    if (rc != 0) {
+        if (link && errno == ENOENT) {
+            // 悬空的链接不是常规文件，与 is_regular_file 一致，不报错
+            return true;
+        }
+        entry.error = errno;
+        return false;
+    }
+    if (need_type) {
+        entry.regular = S_ISREG(stx.stx_mode);
+        entry.directory = !link && S_ISDIR(stx.stx_mode);
+    }
+    if (candidate && entry.regular && (stx.stx_mask & STATX_SIZE)) {
+        entry.size = stx.stx_size;
+        entry.mtime_ns = timestamp_ns(stx.stx_mtime);
+        entry.has_episode = true;
+    }
+    return true;
+}
+
+class DirFd {
+public:
+    explicit DirFd(const fs::path& dir) : m_fd(::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)) {
+        if (m_fd < 0) {
+            throw fs::filesystem_error("open directory", dir, std::error_code(errno, std::generic_category()));
+        }
+    }
+    ~DirFd() { ::close(m_fd); }
+    DirFd(const DirFd&) = delete;
+    DirFd& operator=(const DirFd&) = delete;
+
+    int fd() const { return m_fd; }
+
+private:
+    int m_fd;
+};
+
+} // namespace
+
+std::vector<DirEntry> scan_directory(const fs::path& dir, FsCounters& counters) {
+    ++counters.dir_opens;
+    DirFd dirfd(dir);
+    std::vector<DirEntry> entries;
+    std::vector<char> buf(DENTS_BUFFER);
+    while (true) {
+        ++counters.dir_reads;
+        long n = ::syscall(SYS_getdents64, dirfd.fd(), buf.data(), buf.size());
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw fs::filesystem_error("getdents64", dir, std::error_code(errno, std::generic_category()));
+        }
+        if (n == 0) {
+            break;
+        }
+        for (long off = 0; off < n;) {
+            const auto* d = reinterpret_cast<const LinuxDirent64*>(buf.data() + off);
+            off += d->d_reclen;
+            if (is_dot(d->d_name)) {
+                continue;
+            }
+            DirEntry item;
+            item.name = d->d_name;
+            if (d->d_type == DT_UNKNOWN) {
+                statx_entry(dirfd.fd(), d->d_name, true, false, item, counters);
+            } else if (d->d_type == DT_REG) {
+                item.regular = true;
+                statx_entry(dirfd.fd(), d->d_name, false, false, item, counters);
+            } else if (d->d_type == DT_LNK) {
+                statx_entry(dirfd.fd(), d->d_name, true, true, item, counters);
+            } else if (d->d_type == DT_DIR) {
+                item.directory = true;
+            }
+            entries.push_back(std::move(item));
+        }
+    }
+    return entries;
+}
+
+bool stat_entry(const fs::path& dir, const std::string& name, DirEntry& entry, FsCounters& counters) {
+    entry = DirEntry{};
+    entry.name = name;
+    const std::string path = (dir / name).string();
+    if (!statx_entry(AT_FDCWD, path.c_str(), true, false, entry, counters)) {
+        return entry.error != ENOENT;
+    }
+    return true;
+}
+
+bool directory_mtime(const fs::path& dir, int64_t& mtime_ns, FsCounters& counters) {
+    struct statx stx;
+    ++counters.stats;
+    if (::statx(AT_FDCWD, dir.c_str(), 0, STATX_MTIME, &stx) != 0 || !(stx.stx_mask & STATX_MTIME)) {
+        return false;
+    }
+    mtime_ns = timestamp_ns(stx.stx_mtime);
+    return true;
+}
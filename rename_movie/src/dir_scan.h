@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "episode_matcher.h"
+
+// 本程序发出的文件系统调用次数 (每个计数对应一次系统调用)
+struct FsCounters {
+    uint64_t dir_opens = 0;  // 打开目录 (另有一次对应的 close)
+    uint64_t dir_reads = 0;  // getdents64
+    uint64_t stats = 0;      // statx
+    uint64_t renames = 0;
+    uint64_t removes = 0;
+    uint64_t copy_syscalls = 0;  // 跨文件系统复制的全部调用 (open/copy_file_range/fsync/unlink 等)
+    uint64_t copies = 0;         // 跨文件系统复制的文件 (不是系统调用)
+    uint64_t bytes_copied = 0;
+
+    uint64_t total() const { return 2 * dir_opens + dir_reads + stats + renames + removes + copy_syscalls; }
+
+    FsCounters& operator+=(const FsCounters& other) {
+        dir_opens += other.dir_opens;
+        dir_reads += other.dir_reads;
+        stats += other.stats;
+        renames += other.renames;
+        removes += other.removes;
+        copy_syscalls += other.copy_syscalls;
+        copies += other.copies;
+        bytes_copied += other.bytes_copied;
+        return *this;
+    }
+};
+
+// 目录快照中的一项
+struct DirEntry {
+    std::string name;
+    bool regular = false;      // 常规文件 (含指向常规文件的符号链接)
+    bool directory = false;    // 目录 (不包括指向目录的符号链接)
+    bool has_episode = false;  // 文件名中含季集标记 (且已读到大小)
+    EpisodeMatch match;
+    uintmax_t size = 0;        // 仅含季集标记的常规文件才读取大小和修改时间
+    int64_t mtime_ns = 0;
+    int error = 0;             // 读取类型或大小失败时的 errno
+};
+
+/**
+ * @brief 用 getdents64 读取目录，文件类型直接取自目录项的 d_type。
+ *
+ * 只有两种情况需要 statx，且只请求需要的字段：
+ *   - 文件系统不提供 d_type (DT_UNKNOWN)：请求 STATX_TYPE，若是含季集标记的
+ *     常规文件则同时请求 STATX_SIZE | STATX_MTIME；
+ *   - 含季集标记的常规文件：请求 STATX_SIZE | STATX_MTIME；
+ *   - 含季集标记的符号链接 (DT_LNK)：跟随链接 statx，指向常规文件时与常规文件
+ *     一样处理 (与 std::filesystem::is_regular_file 相同，重命名的是链接本身)。
+ * 因此每个候选文件一次 statx，其它条目不 stat。statx 相对于目录 fd 调用，
+ * 不必每次解析完整路径。目录无法打开时抛出 std::filesystem::filesystem_error。
+ */
+std::vector<DirEntry> scan_directory(const std::filesystem::path& dir, FsCounters& counters);
+
+// 用一次 statx 读取目录中单个文件的类型和大小 (监视模式)，文件不存在时返回 false
+bool stat_entry(const std::filesystem::path& dir, const std::string& name, DirEntry& entry, FsCounters& counters);
+
+// 用一次 statx 读取目录的修改时间 (纳秒)，失败时返回 false
+bool directory_mtime(const std::filesystem::path& dir, int64_t& mtime_ns, FsCounters& counters);
@@ -0,0 +1,351 @@
+#include "episode_matcher.h"
+
+#include <cstdint>
+#include <fmt/format.h>
+
+namespace {
+
+// 字符分类表：扫描时每个字符只查一次表，大小写折叠也在表里完成
+enum CharClass : uint8_t {
+    CHAR_OTHER,
+    CHAR_DIGIT,
+    CHAR_SEP,   // 空格 . _ -
+    CHAR_ALPHA,
+};
+
+struct CharTable {
+    uint8_t cls[256];
+    char lower[256];
+    bool starts[256]; // 能开始一个候选的字符：'s'、'S' 和数字
+};
+
+constexpr CharTable make_char_table() {
+    CharTable t{};
+    for (int c = 0; c < 256; ++c) {
+        t.cls[c] = CHAR_OTHER;
+        t.lower[c] = static_cast<char>(c);
+        t.starts[c] = (c >= '0' && c <= '9') || c == 's' || c == 'S';
+        if (c >= '0' && c <= '9') {
+            t.cls[c] = CHAR_DIGIT;
+        } else if (c == ' ' || c == '.' || c == '_' || c == '-') {
+            t.cls[c] = CHAR_SEP;
+        } else if (c >= 'a' && c <= 'z') {
+            t.cls[c] = CHAR_ALPHA;
+        } else if (c >= 'A' && c <= 'Z') {
+            t.cls[c] = CHAR_ALPHA;
+            t.lower[c] = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return t;
+}
+
+constexpr CharTable CHARS = make_char_table();
+
+constexpr char SEASON_WORD[] = "season";   // 前缀 "s" 或 "season"
+constexpr char EPISODE_WORD[] = "episode"; // 关键字 "e"、"ep" 或 "episode"
+constexpr unsigned SEASON_LEN = 6;
+constexpr unsigned EPISODE_LEN = 7;
+constexpr unsigned MAX_DIGITS = 3;
+
+// "e"、"ep"、"episode" 之后可以接数字
+constexpr bool episode_keyword_done(unsigned k) {
+    return k == 1 || k == 2 || k == EPISODE_LEN;
+}
+
+/**
+ * S/Season 系列的状态机：
+ *   ("s" | "season" 分隔符*) 季数字{1,3} 分隔符* ("e" | "ep" | "episode") 分隔符* 集数字{1,3}
+ * 数字与旧正则一样贪婪地最多取 3 位。候选失败时把当前字符重新交给初始状态，
+ * 新候选只能从 's' 开始；"season" 内部的 "seas" 和 "episode" 内部的 "epis"
+ * 失配时按 KMP 退回到末尾的 "s"。
+ */
+class SeasonScanner {
+public:
+    bool active() const { return m_state != IDLE; }
+    size_t start() const { return m_start; }
+
+    // 处理位置 i 的字符；候选在此结束时写入 found 并返回 true
+    bool feed(size_t i, unsigned char c, EpisodeMatch& found) {
+        const uint8_t cls = CHARS.cls[c];
+        const char l = CHARS.lower[c];
+        switch (m_state) {
+        case IDLE:
+            restart(i, l);
+            return false;
+        case PREFIX:
+            if (m_k < SEASON_LEN && l == SEASON_WORD[m_k]) {
+                ++m_k;
+            } else if (m_k == 1 && cls == CHAR_DIGIT) {
+                begin_season(c, true);
+            } else if (m_k == SEASON_LEN && cls == CHAR_SEP) {
+                m_state = SEASON_SEP;
+            } else if (m_k == SEASON_LEN && cls == CHAR_DIGIT) {
+                begin_season(c, false);
+            } else if (m_k == 4) {
+                // "seas" 的后缀 "s" 可能是新候选的开头
+                m_start = i - 1;
+                m_k = 1;
+                return feed(i, c, found);
+            } else {
+                restart(i, l);
+            }
+            return false;
+        case SEASON_SEP:
+            if (cls == CHAR_DIGIT) {
+                begin_season(c, false);
+            } else if (cls != CHAR_SEP) {
+                restart(i, l);
+            }
+            return false;
+        case SEASON_DIGITS:
+            if (cls == CHAR_DIGIT && m_digits < MAX_DIGITS) {
+                m_season = m_season * 10 + (c - '0');
+                ++m_digits;
+            } else if (l == 'e') {
+                m_state = KEYWORD;
+                m_k = 1;
+            } else if (cls == CHAR_SEP) {
+                m_state = KEYWORD_SEP;
+                m_compact = false;
+            } else {
+                restart(i, l);
+            }
+            return false;
+        case KEYWORD_SEP:
+            if (l == 'e') {
+                m_state = KEYWORD;
+                m_k = 1;
+            } else if (cls != CHAR_SEP) {
+                restart(i, l);
+            }
+            return false;
+        case KEYWORD:
+            if (m_k < EPISODE_LEN && l == EPISODE_WORD[m_k]) {
+                ++m_k;
+                m_compact = false;
+            } else if (episode_keyword_done(m_k) && cls == CHAR_DIGIT) {
+                m_state = EPISODE_DIGITS;
+                m_episode = c - '0';
+                m_digits = 1;
+            } else if (episode_keyword_done(m_k) && cls == CHAR_SEP) {
+                m_state = EPISODE_SEP;
+                m_compact = false;
+            } else if (m_k == 4) {
+                // "epis" 的后缀 "s" 可能是新候选的开头 (如 S01.Epis01E02 中的 s01E02)
+                m_state = PREFIX;
+                m_start = i - 1;
+                m_k = 1;
+                return feed(i, c, found);
+            } else {
+                restart(i, l);
+            }
+            return false;
+        case EPISODE_SEP:
+            if (cls == CHAR_DIGIT) {
+                m_state = EPISODE_DIGITS;
+                m_episode = c - '0';
+                m_digits = 1;
+            } else if (cls != CHAR_SEP) {
+                restart(i, l);
+            }
+            return false;
+        case EPISODE_DIGITS:
+            if (cls == CHAR_DIGIT) {
+                m_episode = m_episode * 10 + (c - '0');
+                if (++m_digits == MAX_DIGITS) {
+                    accept(i + 1, found);
+                    return true;
+                }
+                return false;
+            }
+            accept(i, found);
+            return true;
+        }
+        return false;
+    }
+
+    // 名字结束时仍在读集数字则成功
+    bool finish(size_t end, EpisodeMatch& found) {
+        if (m_state != EPISODE_DIGITS) {
+            return false;
+        }
+        accept(end, found);
+        return true;
+    }
+
+private:
+    enum State : uint8_t {
+        IDLE,
+        PREFIX,         // 已匹配 "season" 的前 m_k 个字符
+        SEASON_SEP,
+        SEASON_DIGITS,
+        KEYWORD_SEP,
+        KEYWORD,        // 已匹配 "episode" 的前 m_k 个字符
+        EPISODE_SEP,
+        EPISODE_DIGITS,
+    };
+
+    void restart(size_t i, char l) {
+        if (l == 's') {
+            m_state = PREFIX;
+            m_start = i;
+            m_k = 1;
+        } else {
+            m_state = IDLE;
+        }
+    }
+
+    void begin_season(unsigned char c, bool compact) {
+        m_state = SEASON_DIGITS;
+        m_season = c - '0';
+        m_digits = 1;
+        m_compact = compact;
+    }
+
+    void accept(size_t end, EpisodeMatch& found) {
+        found.pos = m_start;
+        found.len = end - m_start;
+        found.season = m_season;
+        found.episode = m_episode;
+        found.compact = m_compact;
+        m_state = IDLE;
+    }
+
+    State m_state = IDLE;
+    size_t m_start = 0;
+    unsigned m_k = 0;
+    unsigned m_digits = 0;
+    unsigned m_season = 0;
+    unsigned m_episode = 0;
+    bool m_compact = false;
+};
+
+/**
+ * NxM 形式的状态机：季数字{1,2} 'x' 集数字{2,3}。
+ * 季数字前不能是字母或数字，集数字后不能再跟数字，所以失败的字符不可能
+ * 是新候选的开头，直接回到初始状态即可。
+ */
+class CrossScanner {
+public:
+    bool active() const { return m_state != IDLE; }
+    size_t start() const { return m_start; }
+
+    bool feed(size_t i, unsigned char c, bool prev_alnum, EpisodeMatch& found) {
+        const uint8_t cls = CHARS.cls[c];
+        switch (m_state) {
+        case IDLE:
+            if (cls == CHAR_DIGIT && !prev_alnum) {
+                m_state = SEASON_DIGITS;
+                m_start = i;
+                m_season = c - '0';
+                m_digits = 1;
+            }
+            return false;
+        case SEASON_DIGITS:
+            if (cls == CHAR_DIGIT && m_digits < 2) {
+                m_season = m_season * 10 + (c - '0');
+                ++m_digits;
+            } else if (CHARS.lower[c] == 'x') {
+                m_state = CROSS;
+            } else {
+                m_state = IDLE;
+            }
+            return false;
+        case CROSS:
+            if (cls == CHAR_DIGIT) {
+                m_state = EPISODE_DIGITS;
+                m_episode = c - '0';
+                m_digits = 1;
+            } else {
+                m_state = IDLE;
+            }
+            return false;
+        case EPISODE_DIGITS:
+            if (cls == CHAR_DIGIT) {
+                if (m_digits == MAX_DIGITS) {
+                    m_state = IDLE;
+                } else {
+                    m_episode = m_episode * 10 + (c - '0');
+                    ++m_digits;
+                }
+                return false;
+            }
+            return finish(i, found);
+        }
+        return false;
+    }
+
+    bool finish(size_t end, EpisodeMatch& found) {
+        bool ok = m_state == EPISODE_DIGITS && m_digits >= 2;
+        if (ok) {
+            found.pos = m_start;
+            found.len = end - m_start;
+            found.season = m_season;
+            found.episode = m_episode;
+            found.compact = false;
+        }
+        m_state = IDLE;
+        return ok;
+    }
+
+private:
+    enum State : uint8_t { IDLE, SEASON_DIGITS, CROSS, EPISODE_DIGITS };
+
+    State m_state = IDLE;
+    size_t m_start = 0;
+    unsigned m_digits = 0;
+    unsigned m_season = 0;
+    unsigned m_episode = 0;
+};
+
+} // namespace
+
+bool find_episode(std::string_view name, EpisodeMatch& match) {
+    SeasonScanner season;
+    CrossScanner cross;
+    bool found = false;
+    EpisodeMatch candidate;
+
+    // 两个状态机同步前进；某个候选成功后，只要另一个状态机里还有更靠左的
+    // 候选在进行，就继续读，保证返回最左侧的匹配
+    auto take = [&](const EpisodeMatch& m) {
+        if (!found || m.pos < match.pos) {
+            match = m;
+            found = true;
+        }
+    };
+    auto settled = [&]() {
+        return found && (!season.active() || season.start() > match.pos) &&
+               (!cross.active() || cross.start() > match.pos);
+    };
+
+    for (size_t i = 0; i < name.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(name[i]);
+        // 两个状态机都空闲时，只有候选的首字符才需要处理
+        if (!CHARS.starts[c] && !season.active() && !cross.active()) {
+            continue;
+        }
+        const uint8_t prev = i > 0 ? CHARS.cls[static_cast<unsigned char>(name[i - 1])] : uint8_t(CHAR_OTHER);
+        const bool prev_alnum = prev == CHAR_DIGIT || prev == CHAR_ALPHA;
+        if (season.feed(i, c, candidate)) {
+            take(candidate);
+        }
+        if (cross.feed(i, c, prev_alnum, candidate)) {
+            take(candidate);
+        }
+        if (settled()) {
+            return true;
+        }
+    }
+    if (season.finish(name.size(), candidate)) {
+        take(candidate);
+    }
+    if (cross.finish(name.size(), candidate)) {
+        take(candidate);
+    }
+    return found;
+}
+
+std::string episode_tag(const EpisodeMatch& match) {
+    return fmt::format("S{:02}E{:02}", match.season, match.episode);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// 文件名中的季集标记，例如 S01E02、1x02、Season 1 Episode 2
+struct EpisodeMatch {
+    size_t pos = 0;          // 匹配在文件名中的起始位置
+    size_t len = 0;          // 匹配长度
+    unsigned season = 0;
+    unsigned episode = 0;
+    // 是否为旧版正则 S\d{1,3}E\d{1,3} 能匹配的紧凑形式；旧版本按原文保留
+    // 紧凑形式，用于识别它们已重命名的文件
+    bool compact = false;
+};
+
+/**
+ * @brief 在文件名中查找最左侧的季集标记，一次扫描，不回溯、不分配内存。
+ *
+ * 识别的形式 (不区分大小写，分隔符为空格 . _ -)：
+ *   S01E02、S1E2、S01.E02、S01 EP02、S01 Episode 02
+ *   Season 1 Episode 2、Season.01.Ep.02、Season1E2
+ *   1x02、01x102 (前面不能紧跟字母或数字，集数 2-3 位且后面不能紧跟数字，
+ *   因此 1920x1080 之类的分辨率不会被误认)
+ */
+bool find_episode(std::string_view name, EpisodeMatch& match);
+
+// 用于新文件名的季集部分，所有形式都统一为 S01E02 格式，同一集只有一个目标名
+std::string episode_tag(const EpisodeMatch& match);
@@ -0,0 +1,329 @@
+#include "library.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <fmt/format.h>
+
+#include "media_index.h"
+#include "rename_plan.h"
+#include "thread_pool.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// 目录 mtime 与扫描时间相差不到这么多时不认为目录是干净的：粗粒度时间戳
+// (ext4 的时钟节拍、很多 NFS 上为 1 s，FAT 为 2 s) 下，同一节拍内随后落地的
+// 文件不会改变 mtime。与 git 处理 "racy" 条目的方法相同，这样的目录记录
+// mtime 0，下次一定重新扫描
+constexpr int64_t RACY_WINDOW_NS = 2'000'000'000;
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+struct ShowResult {
+    DirResult result;
+    OutputLog log;
+    std::vector<IndexDir> dirs;        // 写入新索引的目录
+    std::vector<IndexRecord> records;  // 写入新索引的剧集记录
+    uint64_t skipped_dirs = 0;         // mtime 未变、没有扫描的目录
+    bool done = false;
+};
+
+// 处理一部剧：从剧目录开始按名字顺序深度优先遍历各级子目录
+class ShowWalker {
+public:
+    ShowWalker(const fs::path& root, const fs::path& show_dir, const std::string& skip_name,
+               const DedupOptions& dedup_options, const MediaIndex* index, ShowResult& show)
+        : m_root(root), m_show_name(show_dir.filename().string()), m_skip_name(skip_name),
+          m_dedup_options(dedup_options), m_index(index), m_show(show) {}
+
+    void walk(const std::string& rel) {
+        const fs::path dir = m_root / rel;
+        int64_t mtime = 0;
+        bool have_mtime = false;
+        if (m_index != nullptr) {
+            int64_t indexed = 0;
+            have_mtime = directory_mtime(dir, mtime, m_show.result.counters);
+            if (have_mtime && mtime != 0 && m_index->dir_mtime(rel, indexed) && indexed == mtime) {
+                // 目录项未变化：沿用索引中的文件和子目录
+                ++m_show.skipped_dirs;
+                m_show.dirs.push_back({rel, mtime});
+                carry_over(rel);
+                for (const std::string& child : m_index->subdirectories(rel)) {
+                    walk(rel + "/" + child);
+                }
+                return;
+            }
+        }
+
+        auto out = std::back_inserter(m_show.log.out);
+        if (!m_header_printed) {
+            fmt::format_to(out, "\n== {} ==\n", m_show_name);
+            m_header_printed = true;
+        }
+        if (rel != m_show_name) {
+            fmt::format_to(out, "-- {}\n", rel.substr(m_show_name.size() + 1));
+        }
+
+        std::vector<DirEntry> entries = snapshot_directory(dir, m_show.result.counters, m_show.log);
+        for (const DirEntry& entry : entries) {
+            m_show.result.files += entry.has_episode;
+        }
+        RenamePlanner planner(m_show_name, m_skip_name, dir, dir);
+        for (const DirEntry& entry : entries) {
+            planner.add_existing(entry);
+        }
+        DuplicateChecker dedup(m_dedup_options);
+        if (m_index != nullptr) {
+            remember_indexed_hashes(rel, dir, entries, dedup);
+        }
+        std::vector<RenameAction> plan = plan_batch(planner, entries, dedup);
+        m_show.result.dedup += dedup.stats();
+        size_t failures = execute_plan(dir, dir, plan, 1, m_show.result.counters, m_show.log);
+
+        if (m_index != nullptr) {
+            std::unordered_map<std::string, uint64_t> hashes;
+            if (failures == 0) {
+                // 有步骤失败时无法确定哈希对应哪个名字，不记录
+                hashes = hashes_after(dir, entries, plan, dedup);
+            }
+            bool changed = std::any_of(plan.begin(), plan.end(),
+                                       [](const RenameAction& a) { return a.kind != RenameKind::AlreadyNamed; });
+            if (changed) {
+                // 先取 mtime 再读目录：此后落地的文件会让下次的 mtime 不同
+                have_mtime = directory_mtime(dir, mtime, m_show.result.counters);
+                entries = snapshot_directory(dir, m_show.result.counters, m_show.log);
+            }
+            // 有失败的步骤或读取失败的文件时不标记为干净，下次重新扫描并重试
+            for (const DirEntry& entry : entries) {
+                failures += entry.error != 0;
+            }
+            const bool clean = have_mtime && failures == 0 && mtime <= now_ns() - RACY_WINDOW_NS;
+            m_show.dirs.push_back({rel, clean ? mtime : 0});
+            for (const DirEntry& entry : entries) {
+                if (!entry.has_episode) {
+                    continue;
+                }
+                IndexRecord rec{m_show_name, entry.match.season, entry.match.episode, rel, entry.name,
+                                entry.size,  entry.mtime_ns,     0,                    false};
+                auto h = hashes.find(entry.name);
+                if (h != hashes.end()) {
+                    rec.sample = h->second;
+                    rec.has_sample = true;
+                }
+                m_show.records.push_back(std::move(rec));
+            }
+        }
+
+        std::vector<std::string> children;
+        for (const DirEntry& entry : entries) {
+            if (entry.directory) {
+                children.push_back(entry.name);
+            }
+        }
+        std::sort(children.begin(), children.end());
+        for (const std::string& child : children) {
+            walk(rel + "/" + child);
+        }
+    }
+
+private:
+    // 索引中这部剧的记录按目录分组，第一次需要时建立
+    const std::vector<size_t>& indexed_records(const std::string& rel) {
+        if (!m_grouped) {
+            auto [first, last] = m_index->find_show(m_show_name);
+            for (size_t i = first; i < last; ++i) {
+                m_by_dir[std::string(m_index->record_dir(i))].push_back(i);
+            }
+            m_grouped = true;
+        }
+        static const std::vector<size_t> none;
+        auto it = m_by_dir.find(rel);
+        return it == m_by_dir.end() ? none : it->second;
+    }
+
+    void carry_over(const std::string& rel) {
+        for (size_t i : indexed_records(rel)) {
+            m_show.records.push_back(m_index->record(i));
+        }
+    }
+
+    // 大小和修改时间都与索引一致的文件，直接使用索引中的抽样哈希 (O(log n) 查找)
+    void remember_indexed_hashes(const std::string& rel, const fs::path& dir, const std::vector<DirEntry>& entries,
+                                 DuplicateChecker& dedup) const {
+        for (const DirEntry& entry : entries) {
+            if (!entry.has_episode) {
+                continue;
+            }
+            auto [first, last] = m_index->find(m_show_name, entry.match.season, entry.match.episode);
+            for (size_t i = first; i < last; ++i) {
+                if (m_index->record_dir(i) != rel || m_index->record_name(i) != entry.name) {
+                    continue;
+                }
+                IndexRecord rec = m_index->record(i);
+                if (rec.has_sample && rec.size == entry.size && rec.mtime_ns == entry.mtime_ns) {
+                    dedup.remember(dir / entry.name, rec.sample);
+                }
+            }
+        }
+    }
+
+    // 执行计划后，各文件名对应的已知抽样哈希 (重命名时哈希跟随文件)
+    static std::unordered_map<std::string, uint64_t> hashes_after(const fs::path& dir,
+                                                                  const std::vector<DirEntry>& entries,
+                                                                  const std::vector<RenameAction>& plan,
+                                                                  const DuplicateChecker& dedup) {
+        std::unordered_map<std::string, uint64_t> hashes;
+        uint64_t sample = 0;
+        for (const DirEntry& entry : entries) {
+            if (entry.has_episode && dedup.known_sample(dir / entry.name, sample)) {
+                hashes[entry.name] = sample;
+            }
+        }
+        for (const RenameAction& action : plan) {
+            if (action.kind == RenameKind::AlreadyNamed) {
+                continue;
+            }
+            auto it = hashes.find(action.from);
+            bool known = it != hashes.end();
+            sample = known ? it->second : 0;
+            if (known) {
+                hashes.erase(it);
+            }
+            if (known && action.kind != RenameKind::RemoveDuplicate) {
+                hashes[action.to] = sample;
+            }
+        }
+        return hashes;
+    }
+
+    const fs::path& m_root;
+    std::string m_show_name;
+    const std::string& m_skip_name;
+    const DedupOptions& m_dedup_options;
+    const MediaIndex* m_index;
+    ShowResult& m_show;
+    bool m_header_printed = false;
+    bool m_grouped = false;
+    std::unordered_map<std::string, std::vector<size_t>> m_by_dir;
+};
+
+void process_show(const fs::path& root, const fs::path& show_dir, const std::string& skip_name,
+                  const DedupOptions& dedup_options, const MediaIndex* index, ShowResult& show) {
+    ShowWalker walker(root, show_dir, skip_name, dedup_options, index, show);
+    try {
+        walker.walk(show_dir.filename().string());
+    } catch (const fs::filesystem_error& e) {
+        fmt::format_to(std::back_inserter(show.log.err), "文件系统错误: {}\n", e.what());
+    }
+}
+
+fs::path index_path(const LibraryOptions& options) {
+    return options.index_file.empty() ? options.root / MEDIA_INDEX_NAME : options.index_file;
+}
+
+} // namespace
+
+int run_library(const LibraryOptions& options, const std::string& skip_name) {
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::vector<fs::path> shows;
+    for (const auto& entry : fs::directory_iterator(options.root)) {
+        if (entry.is_directory() && !entry.is_symlink()) {
+            shows.push_back(entry.path());
+        }
+    }
+    std::sort(shows.begin(), shows.end());
+    fmt::print("媒体库: {} ({} 部剧)\n", options.root.string(), shows.size());
+
+    MediaIndex index;
+    if (options.use_index) {
+        std::string error;
+        if (!index.open(index_path(options), error)) {
+            fmt::print(stderr, "索引 {} 无效 ({})，将重新建立\n", index_path(options).string(), error);
+        }
+    }
+    const MediaIndex* index_ptr = options.use_index ? &index : nullptr;
+
+    ThreadPool pool(options.threads);
+    // 多部剧并行时全量哈希各用一个线程，避免线程数相乘
+    DedupOptions dedup_options = options.dedup;
+    if (pool.size() > 1) {
+        dedup_options.threads = 1;
+    }
+
+    // 完成的剧按顺序打印：第 i 部剧只有在前面的剧都打印后才输出
+    std::vector<ShowResult> results(shows.size());
+    std::mutex print_mutex;
+    size_t next_print = 0;
+    pool.parallel_for(shows.size(), [&](size_t i) {
+        process_show(options.root, shows[i], skip_name, dedup_options, index_ptr, results[i]);
+        std::lock_guard<std::mutex> lock(print_mutex);
+        results[i].done = true;
+        while (next_print < results.size() && results[next_print].done) {
+            results[next_print++].log.flush();
+        }
+    });
+
+    DirResult total;
+    uint64_t skipped_dirs = 0;
+    std::vector<IndexDir> dirs;
+    std::vector<IndexRecord> records;
+    for (ShowResult& show : results) {
+        total += show.result;
+        skipped_dirs += show.skipped_dirs;
+        std::move(show.dirs.begin(), show.dirs.end(), std::back_inserter(dirs));
+        std::move(show.records.begin(), show.records.end(), std::back_inserter(records));
+    }
+    int status = 0;
+    if (options.use_index) {
+        try {
+            fmt::print("\n索引: {} 个目录 (未变化跳过 {} 个), {} 条剧集记录\n", dirs.size(), skipped_dirs,
+                       records.size());
+            write_media_index(index_path(options), std::move(dirs), std::move(records));
+        } catch (const fs::filesystem_error& e) {
+            fmt::print(stderr, "文件系统错误: {}\n", e.what());
+            status = 1;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    fmt::print("\n所有剧集处理完毕: {} 部剧, {} 个文件, {:.3f} s, {:.0f} 个文件/秒 ({} 线程)\n", shows.size(),
+               total.files, seconds, total.files / std::max(seconds, 1e-9), pool.size());
+    if (options.stats) {
+        print_fs_stats(total, seconds);
+    }
+    return status;
+}
+
+int run_lookup(const LibraryOptions& options, const std::string& show, const std::string& tag) {
+    EpisodeMatch match;
+    if (!find_episode(tag, match)) {
+        fmt::print(stderr, "无法识别的季集标记: {}\n", tag);
+        return 1;
+    }
+    MediaIndex index;
+    std::string error;
+    if (!index.open(index_path(options), error)) {
+        fmt::print(stderr, "索引 {} 无效: {}\n", index_path(options).string(), error);
+        return 1;
+    }
+    auto [first, last] = index.find(show, match.season, match.episode);
+    fmt::print("{} S{:02}E{:02}: {} 个文件 (索引共 {} 条记录)\n", show, match.season, match.episode, last - first,
+               index.record_count());
+    for (size_t i = first; i < last; ++i) {
+        IndexRecord rec = index.record(i);
+        std::string hash = rec.has_sample ? fmt::format("{:016x}", rec.sample) : std::string("-");
+        fmt::print("  {}/{}  {:.2f} MB  抽样哈希 {}\n", rec.dir, rec.name, static_cast<double>(rec.size) / (1024 * 1024),
+                   hash);
+    }
+    return first == last ? 1 : 0;
+}
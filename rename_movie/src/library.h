@@ -0,0 +1,43 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+#include "content_hash.h"
+
+struct LibraryOptions {
+    std::filesystem::path root;
+    unsigned threads = 0;  // 同时处理的剧集目录数，0 表示硬件线程数
+    DedupOptions dedup;
+    bool stats = false;    // 结束时打印系统调用次数
+    // 使用持久索引 (默认为 根目录/.rename_movie.idx)：mtime 未变的目录不再扫描，
+    // 重复检查优先使用索引中的抽样哈希
+    bool use_index = false;
+    std::filesystem::path index_file;
+};
+
+/**
+ * @brief 处理媒体库根目录下的所有剧集。
+ *
+ * 根目录下的每个子目录是一部剧 (剧名为子目录名)，作为线程池中的一个任务；
+ * 剧目录及其下的各级子目录 (如 "Season 1") 依次在同一个任务中处理，文件名
+ * 都使用该剧名。不同的剧并行扫描、计划和重命名，同一目录内的重命名按计划
+ * 顺序串行执行。每部剧的输出先缓存，按剧名排序后依次打印，输出与线程数无关。
+ *
+ * 使用索引时，目录 mtime 与索引中记录的相同则跳过扫描，沿用索引中的文件和
+ * 子目录。扫描过的目录如果有文件被重命名或删除，执行后重新读取 mtime 和目录，
+ * 再写入索引，这样执行期间新落地的文件下次仍会被处理。mtime 距扫描时间
+ * 不足一个时间戳精度 (按 2 s 计) 或有步骤失败的目录记为未扫描，下次重新
+ * 扫描。结束时写出新索引。
+ *
+ * @return 进程退出码
+ */
+int run_library(const LibraryOptions& options, const std::string& skip_name);
+
+/**
+ * @brief 只读索引，列出 (剧名, 季集) 对应的文件，不访问媒体库目录。
+ *
+ * @param tag 季集标记，例如 S01E02 或 1x02
+ * @return 进程退出码；没有找到记录时为 1
+ */
+int run_lookup(const LibraryOptions& options, const std::string& show, const std::string& tag);
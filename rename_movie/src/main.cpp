@@ -1,12 +1,247 @@
 #include <iostream>
+#include <charconv>
+#include <chrono>
+#include <cstring>
 #include <filesystem>
+#include <random>
 #include <regex>
 #include <string>
+#include <vector>
 // 假设您已经安装了 fmt 库，这是一个非常优秀的 C++ 格式化库
 // 如果没有，可以通过 vcpkg install fmt 安装
 #include <fmt/format.h>
 
+#include "episode_matcher.h"
+#include "library.h"
+#include "rename_plan.h"
+#include "watch.h"
+
+// 旧版的匹配方式，仅用于基准对比
+static const char* LEGACY_PATTERN = R"(S\d{1,3}E\d{1,3})";
+
+// 解析整个参数为整数；有多余字符或超出范围时返回 false，value 不变
+template <typename T>
+static bool parse_number(const char* text, T& value) {
+    const char* end = text + std::strlen(text);
+    T parsed{};
+    auto [ptr, ec] = std::from_chars(text, end, parsed);
+    if (ec != std::errc() || ptr != end) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// 生成 count 个模拟目录中的文件名：常见的几种季集写法加上不含季集的文件
+static std::vector<std::string> make_synthetic_names(size_t count) {
+    static const char* shows[] = {"The.Expanse", "Breaking Bad", "dark", "Better_Call_Saul",
+                                  "Game.of.Thrones", "The Office US", "Severance", "Shogun"};
+    std::mt19937 rng(12345);
+    std::vector<std::string> names;
+    names.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const char* show = shows[rng() % 8];
+        unsigned season = 1 + rng() % 12;
+        unsigned episode = 1 + rng() % 24;
+        switch (rng() % 9) {
+        case 0:
+        case 1:
+            names.push_back(fmt::format("{}.S{:02}E{:02}.1080p.WEB-DL.DDP5.1.x264-GRP.mkv", show, season, episode));
+            break;
+        case 2:
+            names.push_back(fmt::format("{}_s{}e{}_720p.mp4", show, season, episode));
+            break;
+        case 3:
+            names.push_back(fmt::format("{} - {}x{:02} - Pilot.1920x1080.avi", show, season, episode));
+            break;
+        case 4:
+            names.push_back(fmt::format("{} Season {} Episode {}.mkv", show, season, episode));
+            break;
+        case 5:
+            names.push_back(fmt::format("{}.S{:02}.E{:02}.HDTV.mkv", show, season, episode));
+            break;
+        case 6:
+            names.push_back(fmt::format("{}.{}.1080p.BluRay.x265.mkv", show, 2000 + season));
+            break;
+        case 7:
+            // "Epis" 失配后要从其中的 's' 重新开始，旧正则匹配 s01E02
+            names.push_back(fmt::format("{}.S{:02}.Epis{:02}E{:02}.mkv", show, season, season, episode));
+            break;
+        default:
+            names.push_back(fmt::format("sample-{}.nfo", i));
+            break;
+        }
+    }
+    return names;
+}
+
+// 比较旧的 std::regex 与新的状态机在 count 个文件名上的耗时
+static int bench_match(size_t count) {
+    std::vector<std::string> names = make_synthetic_names(count);
+    fmt::print("文件名数量: {}\n", names.size());
+
+    std::regex pattern(LEGACY_PATTERN, std::regex_constants::icase);
+    std::vector<std::string> legacy(names.size());
+    size_t legacy_hits = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < names.size(); ++i) {
+        std::smatch match;
+        if (std::regex_search(names[i], match, pattern)) {
+            legacy[i] = match[0];
+            ++legacy_hits;
+        }
+    }
+    double legacy_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::vector<EpisodeMatch> matches(names.size());
+    std::vector<char> found(names.size());
+    size_t hits = 0;
+    t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < names.size(); ++i) {
+        found[i] = find_episode(names[i], matches[i]);
+        hits += found[i];
+    }
+    double matcher_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    // 旧正则能匹配的名字，新匹配器必须匹配到相同的文本
+    size_t mismatches = 0;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (!legacy[i].empty() &&
+            (!found[i] || names[i].compare(matches[i].pos, matches[i].len, legacy[i]) != 0)) {
+            ++mismatches;
+        }
+    }
+
+    fmt::print("std::regex : {:8.3f} s  {:12.0f} 个/秒  匹配 {}\n", legacy_s, names.size() / legacy_s, legacy_hits);
+    fmt::print("状态机     : {:8.3f} s  {:12.0f} 个/秒  匹配 {}\n", matcher_s, names.size() / matcher_s, hits);
+    fmt::print("加速比: {:.1f}x, 与旧正则结果不一致: {}\n", legacy_s / matcher_s, mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
+
 int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--bench-match") {
+        size_t count = 1000000;
+        if (argc > 2 && !parse_number(argv[2], count)) {
+            fmt::print(stderr, "无效的数量: {}\n", argv[2]);
+            return 1;
+        }
+        return bench_match(count);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-watch") {
+        size_t count = 100;
+        int debounce_ms = 50;
+        if (argc > 2 && !parse_number(argv[2], count)) {
+            fmt::print(stderr, "无效的数量: {}\n", argv[2]);
+            return 1;
+        }
+        if (argc > 3 && !parse_number(argv[3], debounce_ms)) {
+            fmt::print(stderr, "无效的去抖时间: {}\n", argv[3]);
+            return 1;
+        }
+        return bench_watch(count, debounce_ms);
+    }
+
+    // --full-hash: 抽样哈希一致后再比较全量哈希；-j N: 线程数
+    // --library ROOT: 处理媒体库根目录下的所有剧集
+    // --watch: 监视当前目录，新文件写完后重命名；--debounce MS: 事件合并窗口
+    // --stats: 结束时打印系统调用次数和用时
+    // --dest DIR: 重命名后移动到 DIR (可以在另一个文件系统)；--io-depth N: 同时复制的文件数
+    // --index: 媒体库模式使用持久索引；--index-file FILE: 索引位置；--lookup SHOW TAG: 只查询索引
+    bool show_stats = false;
+    MoveOptions move;
+    DedupOptions dedup_options;
+    LibraryOptions library;
+    bool library_mode = false;
+    std::string lookup_show;
+    std::string lookup_tag;
+    WatchOptions watch;
+    bool watch_mode = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--full-hash") {
+            dedup_options.full_verify = true;
+        } else if (arg == "-j" && i + 1 < argc && parse_number(argv[i + 1], dedup_options.threads)) {
+            ++i;
+            library.threads = dedup_options.threads;
+        } else if (arg == "--library" && i + 1 < argc) {
+            library_mode = true;
+            library.root = argv[++i];
+        } else if (arg == "--index") {
+            library.use_index = true;
+        } else if (arg == "--index-file" && i + 1 < argc) {
+            library.use_index = true;
+            library.index_file = argv[++i];
+        } else if (arg == "--lookup" && i + 2 < argc) {
+            lookup_show = argv[++i];
+            lookup_tag = argv[++i];
+        } else if (arg == "--stats") {
+            show_stats = true;
+            library.stats = true;
+            watch.stats = true;
+        } else if (arg == "--dest" && i + 1 < argc) {
+            move.dest = argv[++i];
+        } else if (arg == "--io-depth" && i + 1 < argc && parse_number(argv[i + 1], move.io_depth)) {
+            ++i;
+        } else if (arg == "--watch") {
+            watch_mode = true;
+        } else if (arg == "--debounce" && i + 1 < argc && parse_number(argv[i + 1], watch.debounce_ms)) {
+            ++i;
+        } else {
+            fmt::print(stderr, "无效参数: {}\n", arg);
+            fmt::print(stderr,
+                       "用法: {} [--library 根目录 | --watch [--debounce 毫秒]] [--full-hash] [-j 线程数] [--stats]\n"
+                       "         [--dest 目标目录 [--io-depth N]] [--index | --index-file 文件]\n"
+                       "      {} --library 根目录 [--index-file 文件] --lookup 剧名 季集\n"
+                       "      {} --bench-match [N] | --bench-watch [N] [去抖毫秒]\n",
+                       argv[0], argv[0], argv[0]);
+            return 1;
+        }
+    }
+
+    // 获取可执行文件本身的名称，以避免重命名程序自身
+    std::string exe_name;
+    if (argc > 0) {
+        exe_name = std::filesystem::path(argv[0]).filename().string();
+    }
+
+    if (!lookup_tag.empty() && !library_mode) {
+        fmt::print(stderr, "--lookup 需要 --library\n");
+        return 1;
+    }
+
+    // 媒体库模式不等待输入，可以在脚本中运行
+    if (library_mode) {
+        if (!move.dest.empty()) {
+            fmt::print(stderr, "--dest 不能与 --library 一起使用\n");
+            return 1;
+        }
+        library.dedup = dedup_options;
+        try {
+            if (!lookup_tag.empty()) {
+                return run_lookup(library, lookup_show, lookup_tag);
+            }
+            return run_library(library, exe_name);
+        } catch (const std::exception& e) {
+            fmt::print(stderr, "发生错误: {}\n", e.what());
+            return 1;
+        }
+    }
+
+    // 监视模式一直运行到收到 SIGINT/SIGTERM，不等待输入
+    if (watch_mode) {
+        try {
+            watch.dir = std::filesystem::current_path();
+            watch.show = watch.dir.filename().string();
+            watch.skip_name = exe_name;
+            watch.dedup = dedup_options;
+            watch.move = move;
+            return run_watch(watch);
+        } catch (const std::exception& e) {
+            fmt::print(stderr, "发生错误: {}\n", e.what());
+            return 1;
+        }
+    }
+
     try {
         // 获取程序所在的当前工作目录
         std::filesystem::path current_dir = std::filesystem::current_path();
@@ -16,80 +251,18 @@ int main(int argc, char* argv[]) {
         std::string dir_name = current_dir.filename().string();
         fmt::print("Directory name: {}\n", dir_name);
 
-        // 获取可执行文件本身的路径，以避免重命名程序自身
-        std::filesystem::path exe_path;
-        if (argc > 0) {
-            exe_path = current_dir / std::filesystem::path(argv[0]).filename();
-        }
+        // 读取一次目录，之后的冲突检测都在内存中完成
+        auto t0 = std::chrono::steady_clock::now();
+        DirResult result;
+        OutputLog log;
+        process_directory(current_dir, dir_name, exe_name, dedup_options, move, result, log);
+        log.flush();
 
-        // 用于匹配 SxxExx 格式的正则表达式 (例如 S01E01, S1E1, S01E100)
-        std::regex pattern(R"(S\d{1,3}E\d{1,3})", std::regex_constants::icase); // 添加 icase 使其不区分大小写
-
-        // 遍历当前目录下的所有条目
-        for (const auto& entry : std::filesystem::directory_iterator(current_dir)) {
-            // 只处理常规文件，并且跳过可执行文件本身
-            if (entry.is_regular_file() && (!exe_path.empty() && entry.path() != exe_path)) {
-                std::string filename = entry.path().filename().string();
-                std::smatch match;
-
-                // 在文件名中搜索 SxxExx 模式
-                if (std::regex_search(filename, match, pattern)) {
-                    // 提取匹配到的季集部分 (例如 S01E01)
-                    std::string season_episode = match[0];
-                    std::string extension = entry.path().extension().string();
-                    
-                    // 构建基础的新文件名 (不包含后缀)
-                    std::string base_new_filename = dir_name + "." + season_episode;
-                    std::filesystem::path new_path = current_dir / (base_new_filename + extension);
-
-                    // --- 关键修复：防止处理已重命名的文件 ---
-                    // 如果计算出的新路径和当前文件路径完全一样，说明文件已经命名正确，直接跳过
-                    if (entry.path() == new_path) {
-                        fmt::print("文件已是正确格式，跳过: {}\n", filename);
-                        continue; // 继续处理下一个文件
-                    }
-
-                    // --- 原有的优化逻辑 ---
-                    // 检查目标文件是否已经存在
-                    if (std::filesystem::exists(new_path)) {
-                        try {
-                            // 获取源文件和已存在文件的大小
-                            uintmax_t source_size = std::filesystem::file_size(entry.path());
-                            uintmax_t dest_size = std::filesystem::file_size(new_path);
-
-                            // 如果大小相同，则认为是重复文件，删除源文件即可
-                            if (source_size == dest_size) {
-                                fmt::print("发现同名且同大小的重复文件，删除源文件: {}\n", filename);
-                                std::filesystem::remove(entry.path());
-                            } else {
-                                // 如果大小不同，则添加后缀来重命名
-                                int counter = 1;
-                                std::filesystem::path unique_new_path;
-                                do {
-                                    // 构建带后缀的新文件名，例如: "文件名.(1).mkv"
-                                    std::string unique_filename = fmt::format("{}({}){}", base_new_filename, counter++, extension);
-                                    unique_new_path = current_dir / unique_filename;
-                                } while (std::filesystem::exists(unique_new_path)); // 循环直到找到一个不存在的文件名
-
-                                std::filesystem::rename(entry.path(), unique_new_path);
-                                uintmax_t file_size_bytes = std::filesystem::file_size(unique_new_path);
-                                double file_size_mb = static_cast<double>(file_size_bytes) / (1024 * 1024);
-                                fmt::print("重命名(添加后缀): {} -> {} (大小: {:.2f} MB)\n", filename, unique_new_path.filename().string(), file_size_mb);
-                            }
-                        } catch (const std::filesystem::filesystem_error& fs_err) {
-                            fmt::print(stderr, "处理文件冲突时出错 '{}': {}\n", filename, fs_err.what());
-                        }
-                    } else {
-                        // 如果目标文件不存在，直接重命名
-                        std::filesystem::rename(entry.path(), new_path);
-                        uintmax_t file_size_bytes = std::filesystem::file_size(new_path);
-                        double file_size_mb = static_cast<double>(file_size_bytes) / (1024 * 1024);
-                        fmt::print("重命名: {} -> {} (大小: {:.2f} MB)\n", filename, new_path.filename().string(), file_size_mb);
-                    }
-                }
-            }
-        }
         fmt::print("\n所有文件处理完毕。\n");
+        if (show_stats) {
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            print_fs_stats(result, seconds);
+        }
     } catch (const std::filesystem::filesystem_error& e) {
         fmt::print(stderr, "文件系统错误: {}\n", e.what());
     } catch (const std::exception& e) {
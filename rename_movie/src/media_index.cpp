@@ -0,0 +1,365 @@
+#include "media_index.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <tuple>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char INDEX_MAGIC[8] = {'R', 'M', 'I', 'D', 'X', '\0', '\0', '\0'};
+constexpr uint32_t INDEX_VERSION = 1;
+constexpr uint32_t FLAG_HAS_SAMPLE = 1;
+
+} // namespace
+
+struct MediaIndex::FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t dir_count;
+    uint64_t record_count;
+    uint64_t strings_size;
+};
+
+struct MediaIndex::DirSlot {
+    uint32_t path_offset;
+    uint32_t path_length;
+    int64_t mtime_ns;
+};
+
+struct MediaIndex::RecordSlot {
+    uint32_t show_offset;
+    uint32_t show_length;
+    uint32_t name_offset;
+    uint32_t name_length;
+    uint32_t dir;        // 目录表下标
+    uint16_t season;
+    uint16_t episode;
+    uint64_t size;
+    int64_t mtime_ns;
+    uint64_t sample;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(MediaIndex::FileHeader) == 40, "索引文件头布局");
+static_assert(sizeof(MediaIndex::DirSlot) == 16, "目录记录布局");
+static_assert(sizeof(MediaIndex::RecordSlot) == 56, "剧集记录布局");
+
+MediaIndex::~MediaIndex() {
+    close();
+}
+
+void MediaIndex::close() {
+    if (m_map != nullptr) {
+        ::munmap(m_map, m_map_size);
+    }
+    m_map = nullptr;
+    m_map_size = 0;
+    m_dirs = nullptr;
+    m_records = nullptr;
+    m_strings = nullptr;
+    m_dir_count = 0;
+    m_record_count = 0;
+    m_strings_size = 0;
+}
+
+bool MediaIndex::open(const fs::path& file, std::string& error) {
+    close();
+    int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return true;
+        }
+        error = std::generic_category().message(errno);
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+        ::close(fd);
+        error = "文件过短";
+        return false;
+    }
+    void* map = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        error = std::generic_category().message(errno);
+        return false;
+    }
+
+    const auto* header = static_cast<const FileHeader*>(map);
+    const size_t size = static_cast<size_t>(st.st_size);
+    // 先限制各个计数，再计算总长度，损坏的头部不会让求和溢出
+    const bool bounded = header->dir_count <= size && header->record_count <= size && header->strings_size <= size;
+    const uint64_t expected = bounded ? sizeof(FileHeader) + header->dir_count * sizeof(DirSlot) +
+                                            header->record_count * sizeof(RecordSlot) + header->strings_size
+                                      : 0;
+    if (std::memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 || header->version != INDEX_VERSION ||
+        !bounded || expected != size) {
+        ::munmap(map, size);
+        error = "格式不符";
+        return false;
+    }
+
+    m_map = map;
+    m_map_size = size;
+    m_dir_count = static_cast<size_t>(header->dir_count);
+    m_record_count = static_cast<size_t>(header->record_count);
+    m_strings_size = static_cast<size_t>(header->strings_size);
+    const char* base = static_cast<const char*>(map);
+    m_dirs = reinterpret_cast<const DirSlot*>(base + sizeof(FileHeader));
+    m_records = reinterpret_cast<const RecordSlot*>(base + sizeof(FileHeader) + m_dir_count * sizeof(DirSlot));
+    m_strings = base + sizeof(FileHeader) + m_dir_count * sizeof(DirSlot) + m_record_count * sizeof(RecordSlot);
+    // 记录引用的字符串和目录必须在范围内，之后的访问不再检查
+    for (size_t i = 0; i < m_dir_count; ++i) {
+        if (uint64_t(m_dirs[i].path_offset) + m_dirs[i].path_length > m_strings_size) {
+            error = "目录记录越界";
+            close();
+            return false;
+        }
+    }
+    for (size_t i = 0; i < m_record_count; ++i) {
+        const RecordSlot& r = m_records[i];
+        if (uint64_t(r.show_offset) + r.show_length > m_strings_size ||
+            uint64_t(r.name_offset) + r.name_length > m_strings_size || r.dir >= m_dir_count) {
+            error = "剧集记录越界";
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string_view MediaIndex::str(uint32_t offset, uint32_t length) const {
+    return std::string_view(m_strings + offset, length);
+}
+
+std::string_view MediaIndex::dir_path(size_t i) const {
+    return str(m_dirs[i].path_offset, m_dirs[i].path_length);
+}
+
+bool MediaIndex::dir_mtime(std::string_view dir, int64_t& mtime_ns) const {
+    size_t lo = 0;
+    size_t hi = m_dir_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (dir_path(mid) < dir) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == m_dir_count || dir_path(lo) != dir) {
+        return false;
+    }
+    mtime_ns = m_dirs[lo].mtime_ns;
+    return true;
+}
+
+std::vector<std::string> MediaIndex::subdirectories(std::string_view dir) const {
+    // dir 的后代路径都以 "dir/" 开头，在排序后的目录表中连续
+    std::string prefix = std::string(dir) + "/";
+    size_t lo = 0;
+    size_t hi = m_dir_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (dir_path(mid) < prefix) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    std::vector<std::string> children;
+    for (size_t i = lo; i < m_dir_count; ++i) {
+        std::string_view path = dir_path(i);
+        if (path.compare(0, prefix.size(), prefix) != 0) {
+            break;
+        }
+        std::string_view rest = path.substr(prefix.size());
+        if (rest.find('/') == std::string_view::npos) {
+            children.emplace_back(rest);
+        }
+    }
+    std::sort(children.begin(), children.end());
+    return children;
+}
+
+int MediaIndex::compare_record(size_t i, std::string_view show, unsigned season, unsigned episode) const {
+    const RecordSlot& r = m_records[i];
+    int c = str(r.show_offset, r.show_length).compare(show);
+    if (c != 0) {
+        return c;
+    }
+    if (r.season != season) {
+        return r.season < season ? -1 : 1;
+    }
+    if (r.episode != episode) {
+        return r.episode < episode ? -1 : 1;
+    }
+    return 0;
+}
+
+std::pair<size_t, size_t> MediaIndex::find(std::string_view show, unsigned season, unsigned episode) const {
+    size_t lo = 0;
+    size_t hi = m_record_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (compare_record(mid, show, season, episode) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    size_t last = lo;
+    while (last < m_record_count && compare_record(last, show, season, episode) == 0) {
+        ++last;
+    }
+    return {lo, last};
+}
+
+std::pair<size_t, size_t> MediaIndex::find_show(std::string_view show) const {
+    auto show_of = [&](size_t i) { return str(m_records[i].show_offset, m_records[i].show_length); };
+    size_t lo = 0;
+    size_t hi = m_record_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (show_of(mid) < show) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    size_t first = lo;
+    hi = m_record_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (show_of(mid) <= show) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return {first, lo};
+}
+
+std::string_view MediaIndex::record_dir(size_t i) const {
+    return dir_path(m_records[i].dir);
+}
+
+std::string_view MediaIndex::record_name(size_t i) const {
+    return str(m_records[i].name_offset, m_records[i].name_length);
+}
+
+IndexRecord MediaIndex::record(size_t i) const {
+    const RecordSlot& r = m_records[i];
+    IndexRecord rec;
+    rec.show = std::string(str(r.show_offset, r.show_length));
+    rec.season = r.season;
+    rec.episode = r.episode;
+    rec.dir = std::string(record_dir(i));
+    rec.name = std::string(record_name(i));
+    rec.size = r.size;
+    rec.mtime_ns = r.mtime_ns;
+    rec.sample = r.sample;
+    rec.has_sample = (r.flags & FLAG_HAS_SAMPLE) != 0;
+    return rec;
+}
+
+void write_media_index(const fs::path& file, std::vector<IndexDir> dirs, std::vector<IndexRecord> records) {
+    std::sort(dirs.begin(), dirs.end(), [](const IndexDir& a, const IndexDir& b) { return a.path < b.path; });
+    std::sort(records.begin(), records.end(), [](const IndexRecord& a, const IndexRecord& b) {
+        return std::tie(a.show, a.season, a.episode, a.name, a.dir) <
+               std::tie(b.show, b.season, b.episode, b.name, b.dir);
+    });
+
+    // 字符串池：相同的剧名只存一次
+    std::string strings;
+    std::unordered_map<std::string, uint32_t> show_offsets;
+    auto add_string = [&](const std::string& s) {
+        uint32_t offset = static_cast<uint32_t>(strings.size());
+        strings += s;
+        return offset;
+    };
+
+    std::vector<MediaIndex::DirSlot> dir_slots(dirs.size());
+    std::unordered_map<std::string, uint32_t> dir_ids;
+    for (size_t i = 0; i < dirs.size(); ++i) {
+        dir_slots[i] = {add_string(dirs[i].path), static_cast<uint32_t>(dirs[i].path.size()), dirs[i].mtime_ns};
+        dir_ids.emplace(dirs[i].path, static_cast<uint32_t>(i));
+    }
+
+    std::vector<MediaIndex::RecordSlot> record_slots;
+    record_slots.reserve(records.size());
+    for (const IndexRecord& rec : records) {
+        auto dir = dir_ids.find(rec.dir);
+        if (dir == dir_ids.end() || rec.season > UINT16_MAX || rec.episode > UINT16_MAX) {
+            continue;
+        }
+        auto show = show_offsets.find(rec.show);
+        if (show == show_offsets.end()) {
+            show = show_offsets.emplace(rec.show, add_string(rec.show)).first;
+        }
+        MediaIndex::RecordSlot slot{};
+        slot.show_offset = show->second;
+        slot.show_length = static_cast<uint32_t>(rec.show.size());
+        slot.name_length = static_cast<uint32_t>(rec.name.size());
+        slot.name_offset = add_string(rec.name);
+        slot.dir = dir->second;
+        slot.season = static_cast<uint16_t>(rec.season);
+        slot.episode = static_cast<uint16_t>(rec.episode);
+        slot.size = rec.size;
+        slot.mtime_ns = rec.mtime_ns;
+        slot.sample = rec.sample;
+        slot.flags = rec.has_sample ? FLAG_HAS_SAMPLE : 0;
+        record_slots.push_back(slot);
+    }
+
+    MediaIndex::FileHeader header{};
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.dir_count = dir_slots.size();
+    header.record_count = record_slots.size();
+    header.strings_size = strings.size();
+
+    const fs::path tmp = file.string() + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw fs::filesystem_error("写入索引", tmp, std::error_code(errno, std::generic_category()));
+    }
+    auto write_all = [&](const void* data, size_t len) {
+        const char* p = static_cast<const char*>(data);
+        while (len > 0) {
+            ssize_t n = ::write(fd, p, len);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            p += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    };
+    bool ok = write_all(&header, sizeof(header)) &&
+              write_all(dir_slots.data(), dir_slots.size() * sizeof(MediaIndex::DirSlot)) &&
+              write_all(record_slots.data(), record_slots.size() * sizeof(MediaIndex::RecordSlot)) &&
+              write_all(strings.data(), strings.size()) && ::fsync(fd) == 0;
+    int err = errno;
+    ok = (::close(fd) == 0) && ok;
+    if (!ok || ::rename(tmp.c_str(), file.c_str()) != 0) {
+        err = ok ? errno : err;
+        ::unlink(tmp.c_str());
+        throw fs::filesystem_error("写入索引", file, std::error_code(err, std::generic_category()));
+    }
+}
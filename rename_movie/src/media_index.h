@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// 媒体库根目录下的默认索引文件名
+constexpr const char* MEDIA_INDEX_NAME = ".rename_movie.idx";
+
+// 索引中的一个剧集文件 (构建索引时使用的内存形式)
+struct IndexRecord {
+    std::string show;
+    unsigned season = 0;
+    unsigned episode = 0;
+    std::string dir;    // 相对媒体库根目录的目录
+    std::string name;
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+    uint64_t sample = 0;      // 抽样哈希，has_sample 为 false 时无效
+    bool has_sample = false;  // 只有做过重复检查的文件才有抽样哈希
+};
+
+// 索引中的一个目录：mtime 未变时其中的文件名也未变，可以跳过扫描
+struct IndexDir {
+    std::string path;   // 相对媒体库根目录
+    int64_t mtime_ns = 0;
+};
+
+/**
+ * @brief 只读的媒体索引，整个文件 mmap 后直接在上面二分查找。
+ *
+ * 文件格式 (本机字节序)：文件头、按路径排序的目录表、按 (剧名, 季, 集, 文件名)
+ * 排序的剧集记录表、字符串池。记录是定长的，字符串以偏移量引用字符串池，
+ * 所以打开索引不需要解析或分配内存，查找为 O(log n)。
+ */
+class MediaIndex {
+public:
+    MediaIndex() = default;
+    ~MediaIndex();
+    MediaIndex(const MediaIndex&) = delete;
+    MediaIndex& operator=(const MediaIndex&) = delete;
+
+    /**
+     * @brief 映射索引文件。文件不存在时返回 true 且索引为空；
+     * 格式不对时返回 false 并写入 error，索引为空 (调用方会重建)。
+     */
+    bool open(const std::filesystem::path& file, std::string& error);
+
+    size_t dir_count() const { return m_dir_count; }
+    size_t record_count() const { return m_record_count; }
+
+    // 目录的 mtime，没有记录时返回 false
+    bool dir_mtime(std::string_view dir, int64_t& mtime_ns) const;
+    // dir 的直接子目录 (按名字排序)
+    std::vector<std::string> subdirectories(std::string_view dir) const;
+
+    // 剧集记录的下标范围 [first, last)
+    std::pair<size_t, size_t> find(std::string_view show, unsigned season, unsigned episode) const;
+    std::pair<size_t, size_t> find_show(std::string_view show) const;
+
+    IndexRecord record(size_t i) const;
+    std::string_view record_dir(size_t i) const;
+    std::string_view record_name(size_t i) const;
+
+    // 文件中的布局，定义在 media_index.cpp
+    struct FileHeader;
+    struct DirSlot;
+    struct RecordSlot;
+
+private:
+    void close();
+    std::string_view str(uint32_t offset, uint32_t length) const;
+    std::string_view dir_path(size_t i) const;
+    int compare_record(size_t i, std::string_view show, unsigned season, unsigned episode) const;
+
+    void* m_map = nullptr;
+    size_t m_map_size = 0;
+    const DirSlot* m_dirs = nullptr;
+    const RecordSlot* m_records = nullptr;
+    const char* m_strings = nullptr;
+    size_t m_dir_count = 0;
+    size_t m_record_count = 0;
+    size_t m_strings_size = 0;
+};
+
+/**
+ * @brief 排序并写出索引：先写临时文件并 fsync，再 rename 覆盖旧索引，
+ * 中途失败不会留下损坏的索引。失败时抛出 std::filesystem::filesystem_error。
+ */
+void write_media_index(const std::filesystem::path& file, std::vector<IndexDir> dirs,
+                       std::vector<IndexRecord> records);
@@ -0,0 +1,232 @@
+#include "move_engine.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <fmt/format.h>
+
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "thread_pool.h"
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+std::error_code last_error() {
+    return std::error_code(errno, std::generic_category());
+}
+
+class Fd {
+public:
+    explicit Fd(int fd) : m_fd(fd) {}
+    ~Fd() {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+    }
+    Fd(const Fd&) = delete;
+    Fd& operator=(const Fd&) = delete;
+
+    int get() const { return m_fd; }
+    bool ok() const { return m_fd >= 0; }
+
+    // 显式关闭以检查错误 (例如网络文件系统在 close 时才报告写入失败)
+    int close() {
+        int fd = m_fd;
+        m_fd = -1;
+        return ::close(fd);
+    }
+
+private:
+    int m_fd;
+};
+
+// 内核不支持这对文件系统之间的 copy_file_range 时返回的错误
+bool copy_range_unsupported(int err) {
+    return err == EXDEV || err == EINVAL || err == ENOSYS || err == EOPNOTSUPP;
+}
+
+/**
+ * 复制 in 的全部内容到 out。copied 随复制进度增加 (供进度显示读取)。
+ * 返回复制的字节数，出错时设置 ec。
+ */
+uintmax_t copy_contents(int in, int out, std::atomic<uint64_t>& copied, uint64_t& syscalls, std::error_code& ec) {
+    uintmax_t total = 0;
+    bool use_sendfile = false;
+    while (true) {
+        ssize_t n;
+        ++syscalls;
+        if (!use_sendfile) {
+            n = ::copy_file_range(in, nullptr, out, nullptr, MOVE_COPY_CHUNK, 0);
+            if (n < 0 && total == 0 && copy_range_unsupported(errno)) {
+                use_sendfile = true;
+                continue;
+            }
+        } else {
+            n = ::sendfile(out, in, nullptr, MOVE_COPY_CHUNK);
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ec = last_error();
+            return total;
+        }
+        if (n == 0) {
+            return total;
+        }
+        total += static_cast<uintmax_t>(n);
+        copied += static_cast<uint64_t>(n);
+    }
+}
+
+void copy_one(CopyJob& job, std::atomic<uint64_t>& copied, FsCounters& counters) {
+    auto t0 = Clock::now();
+    uint64_t& calls = counters.copy_syscalls;
+    const fs::path part = job.to.string() + ".part";
+
+    ++calls;
+    Fd in(::open(job.from.c_str(), O_RDONLY | O_CLOEXEC));
+    if (!in.ok()) {
+        job.ec = last_error();
+        return;
+    }
+    struct stat st;
+    calls += 2;
+    if (::fstat(in.get(), &st) != 0) {
+        job.ec = last_error();
+        return;
+    }
+    ::posix_fadvise(in.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // O_EXCL：不覆盖已有的 .part (可能是另一个进程正在复制)
+    ++calls;
+    Fd out(::open(part.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 07777));
+    if (!out.ok()) {
+        job.ec = last_error();
+        return;
+    }
+    auto fail = [&](std::error_code ec) {
+        job.ec = ec;
+        ++calls;
+        ::unlink(part.c_str());
+    };
+
+    // 预先分配空间，机械硬盘上减少碎片；不支持时忽略
+    ++calls;
+    ::fallocate(out.get(), 0, 0, static_cast<off_t>(st.st_size));
+
+    std::error_code ec;
+    uintmax_t n = copy_contents(in.get(), out.get(), copied, calls, ec);
+    if (ec) {
+        fail(ec);
+        return;
+    }
+    if (n != static_cast<uintmax_t>(st.st_size)) {
+        // 复制期间源文件被修改
+        fail(std::make_error_code(std::errc::io_error));
+        return;
+    }
+    // 保留访问和修改时间，媒体服务器按 mtime 判断 "最近添加"
+    const struct timespec times[2] = {st.st_atim, st.st_mtim};
+    calls += 3;
+    if (::futimens(out.get(), times) != 0 || ::fsync(out.get()) != 0 || out.close() != 0) {
+        fail(last_error());
+        return;
+    }
+    ++calls;
+    if (!rename_no_replace(part, job.to, ec)) {
+        fail(ec);
+        return;
+    }
+    // 新名字所在的目录也落盘后，目标才是持久的；否则崩溃后可能只剩下源文件的删除
+    calls += 3;
+    Fd dir(::open(job.to.parent_path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (!dir.ok() || ::fsync(dir.get()) != 0) {
+        job.ec = last_error();
+        // 保留源文件，移除不确定是否持久的目标，不留下两份
+        ++calls;
+        ::unlink(job.to.c_str());
+        return;
+    }
+    ++calls;
+    if (::unlink(job.from.c_str()) != 0) {
+        job.ec = last_error();
+        return;
+    }
+    ++counters.copies;
+    counters.bytes_copied += n;
+    job.seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+} // namespace
+
+bool rename_no_replace(const fs::path& from, const fs::path& to, std::error_code& ec) {
+    ec.clear();
+    if (::renameat2(AT_FDCWD, from.c_str(), AT_FDCWD, to.c_str(), RENAME_NOREPLACE) == 0) {
+        return true;
+    }
+    if (errno == EINVAL || errno == ENOSYS) {
+        // 文件系统不支持 RENAME_NOREPLACE (部分网络文件系统)
+        if (::rename(from.c_str(), to.c_str()) == 0) {
+            return true;
+        }
+    }
+    ec = last_error();
+    return false;
+}
+
+void copy_across(std::vector<CopyJob>& jobs, unsigned io_depth, FsCounters& counters) {
+    if (jobs.empty()) {
+        return;
+    }
+    uint64_t total_bytes = 0;
+    for (const CopyJob& job : jobs) {
+        total_bytes += job.size;
+    }
+    std::atomic<uint64_t> copied{0};
+    auto t0 = Clock::now();
+
+    // 进度显示线程：只在 stderr 为终端时每秒刷新一行
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool done = false;
+    std::thread progress;
+    if (::isatty(STDERR_FILENO)) {
+        progress = std::thread([&] {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!finished.wait_for(lock, std::chrono::seconds(1), [&] { return done; })) {
+                double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+                double mb = copied.load() / (1024.0 * 1024.0);
+                fmt::print(stderr, "\r跨文件系统复制: {:.0f} / {:.0f} MB, {:.1f} MB/s   ", mb,
+                           total_bytes / (1024.0 * 1024.0), mb / seconds);
+            }
+            fmt::print(stderr, "\r\033[K");
+        });
+    }
+
+    ThreadPool pool(std::max(1u, io_depth));
+    std::vector<FsCounters> job_counters(jobs.size());
+    pool.parallel_for(jobs.size(), [&](size_t i) { copy_one(jobs[i], copied, job_counters[i]); });
+    for (const FsCounters& c : job_counters) {
+        counters += c;
+    }
+
+    if (progress.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        finished.notify_one();
+        progress.join();
+    }
+}
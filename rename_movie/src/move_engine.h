@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+#include "dir_scan.h"
+
+struct MoveOptions {
+    std::filesystem::path dest;  // 目标目录，为空时在原目录内重命名
+    unsigned io_depth = 4;       // 跨文件系统时同时复制的文件数
+};
+
+// 每次 copy_file_range/sendfile 最多复制的字节数
+constexpr size_t MOVE_COPY_CHUNK = 64 * 1024 * 1024;
+
+/**
+ * @brief rename，但目标已存在时失败 (renameat2 RENAME_NOREPLACE)，不会覆盖文件。
+ *
+ * 文件系统不支持该标志时退回普通 rename。跨文件系统时 ec 为 EXDEV。
+ */
+bool rename_no_replace(const std::filesystem::path& from, const std::filesystem::path& to, std::error_code& ec);
+
+// 一个需要跨文件系统复制的文件
+struct CopyJob {
+    std::filesystem::path from;
+    std::filesystem::path to;
+    uintmax_t size = 0;
+    std::error_code ec;   // 失败原因；失败时源文件保留
+    double seconds = 0;
+};
+
+/**
+ * @brief 把 rename 返回 EXDEV 的文件复制到目标文件系统，完成后删除源文件。
+ *
+ * 同时最多复制 io_depth 个文件。每个文件先用 copy_file_range (内核不支持跨
+ * 文件系统时改用 sendfile) 按 MOVE_COPY_CHUNK 大块复制到 "目标名.part"，
+ * 复制访问/修改时间并 fsync 后 rename 到目标名 (不覆盖)，再 fsync 目标目录，
+ * 最后才删除源文件；任何一步失败都删除 .part (或目标) 并保留源文件。
+ * stderr 为终端时每秒显示一次进度和 MB/s。
+ */
+void copy_across(std::vector<CopyJob>& jobs, unsigned io_depth, FsCounters& counters);
@@ -0,0 +1,279 @@
+#include "rename_plan.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <system_error>
+#include <fmt/format.h>
+
+namespace fs = std::filesystem;
+
+void OutputLog::flush() {
+    std::fwrite(out.data(), 1, out.size(), stdout);
+    std::fwrite(err.data(), 1, err.size(), stderr);
+    std::fflush(stdout);
+    out.clear();
+    err.clear();
+}
+
+std::vector<DirEntry> snapshot_directory(const fs::path& dir, FsCounters& counters, OutputLog& log) {
+    std::vector<DirEntry> entries = scan_directory(dir, counters);
+    // getdents 的顺序由文件系统的哈希决定；按名字排序后，同一集的哪个文件保留
+    // 原名、哪个添加后缀，以及输出顺序都是确定的
+    std::sort(entries.begin(), entries.end(), [](const DirEntry& a, const DirEntry& b) { return a.name < b.name; });
+    for (const DirEntry& entry : entries) {
+        if (entry.error != 0) {
+            fmt::format_to(std::back_inserter(log.err), "读取文件大小时出错 '{}': {}\n", entry.name,
+                           std::generic_category().message(entry.error));
+        }
+    }
+    return entries;
+}
+
+namespace {
+
+// 旧版本按原文保留紧凑标记 (如 Show.s01e02.mkv)，这样的名字视为已命名正确，不再重命名
+bool legacy_named(const std::string& show, const DirEntry& entry) {
+    const EpisodeMatch& m = entry.match;
+    return entry.has_episode && m.compact &&
+           entry.name == show + "." + entry.name.substr(m.pos, m.len) + fs::path(entry.name).extension().string();
+}
+
+// name 是否为 base(n)ext：之前因内容不同添加过后缀的文件，不再换一个编号重命名
+bool suffixed_name(const std::string& name, const std::string& base, const std::string& extension) {
+    const size_t digits = name.size() - std::min(name.size(), base.size() + extension.size() + 2);
+    if (digits == 0 || name.compare(0, base.size(), base) != 0 || name[base.size()] != '(' ||
+        name.compare(name.size() - extension.size() - 1, std::string::npos, ")" + extension) != 0) {
+        return false;
+    }
+    return std::all_of(name.begin() + base.size() + 1, name.begin() + base.size() + 1 + digits,
+                       [](char c) { return c >= '0' && c <= '9'; });
+}
+
+} // namespace
+
+RenamePlanner::RenamePlanner(std::string show, std::string skip_name, fs::path source, fs::path dest)
+    : m_show(std::move(show)), m_skip_name(std::move(skip_name)), m_source(std::move(source)),
+      m_dest(std::move(dest)) {}
+
+std::string RenamePlanner::target_name(const DirEntry& entry) const {
+    return m_show + "." + episode_tag(entry.match) + fs::path(entry.name).extension().string();
+}
+
+void RenamePlanner::add_existing(const DirEntry& entry) {
+    m_names.insert_or_assign(entry.name, NameInfo{entry.has_episode, entry.size, m_dest / entry.name});
+    // 旧版本命名的文件同时占用规范名字，同一集的新文件会与它比较内容；
+    // 目录里真有这个规范名字的文件时以真实文件为准
+    if (legacy_named(m_show, entry)) {
+        std::string alias = target_name(entry);
+        if (alias != entry.name && m_names.count(alias) == 0) {
+            m_names.emplace(alias, NameInfo{true, entry.size, m_dest / entry.name});
+            m_aliases.insert_or_assign(entry.name, std::move(alias));
+        }
+    }
+}
+
+void RenamePlanner::remove_existing(const std::string& name) {
+    m_names.erase(name);
+    auto alias = m_aliases.find(name);
+    if (alias != m_aliases.end()) {
+        auto it = m_names.find(alias->second);
+        if (it != m_names.end() && it->second.origin == m_dest / name) {
+            m_names.erase(it);
+        }
+        m_aliases.erase(alias);
+    }
+}
+
+bool RenamePlanner::plan(const DirEntry& entry, DuplicateChecker& dedup, RenameAction& action) {
+    if (!entry.has_episode || entry.name == m_skip_name) {
+        return false;
+    }
+    std::string extension = fs::path(entry.name).extension().string();
+    // 构建基础的新文件名 (不包含后缀)
+    std::string base_new_filename = m_show + "." + episode_tag(entry.match);
+    std::string target = base_new_filename + extension;
+
+    // 新文件名与当前文件名相同 (或为旧版本的命名、带冲突后缀)，说明文件已经命名正确
+    if ((target == entry.name || legacy_named(m_show, entry) ||
+         suffixed_name(entry.name, base_new_filename, extension)) &&
+        same_dir()) {
+        action = {RenameKind::AlreadyNamed, entry.name, entry.name, entry.size};
+        return true;
+    }
+
+    auto existing = m_names.find(target);
+    if (existing == m_names.end()) {
+        action = {RenameKind::Rename, entry.name, target, entry.size};
+    } else if (existing->second.sized && existing->second.size == entry.size &&
+               dedup.same_content(m_source / entry.name, existing->second.origin, entry.size)) {
+        // 同名、同大小且内容哈希一致，认为是重复文件
+        action = {RenameKind::RemoveDuplicate, entry.name, target, entry.size};
+        if (same_dir()) {
+            m_names.erase(entry.name);
+        }
+        return true;
+    } else {
+        // 大小或内容不同 (或目标不是常规文件)，添加后缀，例如: "文件名(1).mkv"
+        int& counter = m_next_suffix[base_new_filename + "/" + extension];
+        if (counter == 0) {
+            counter = 1;
+        }
+        do {
+            target = fmt::format("{}({}){}", base_new_filename, counter++, extension);
+        } while (m_names.count(target) != 0);
+        action = {RenameKind::RenameSuffixed, entry.name, target, entry.size};
+    }
+    if (same_dir()) {
+        m_names.erase(entry.name);
+    }
+    m_names.insert_or_assign(target, NameInfo{true, entry.size, m_source / entry.name});
+    m_unsettled.push_back(target);
+    return true;
+}
+
+void RenamePlanner::settle() {
+    for (const std::string& name : m_unsettled) {
+        auto it = m_names.find(name);
+        if (it != m_names.end()) {
+            it->second.origin = m_dest / name;
+        }
+    }
+    m_unsettled.clear();
+}
+
+std::vector<RenameAction> plan_batch(RenamePlanner& planner, const std::vector<DirEntry>& entries,
+                                     DuplicateChecker& dedup) {
+    std::vector<RenameAction> plan;
+    RenameAction action;
+    for (const DirEntry& entry : entries) {
+        if (planner.plan(entry, dedup, action)) {
+            plan.push_back(std::move(action));
+        }
+    }
+    return plan;
+}
+
+size_t execute_plan(const fs::path& dir, const fs::path& dest, const std::vector<RenameAction>& plan,
+                    unsigned io_depth, FsCounters& counters, OutputLog& log) {
+    auto out = std::back_inserter(log.out);
+    auto err = std::back_inserter(log.err);
+    const bool moving = dir != dest;
+    std::vector<CopyJob> copies;
+    std::vector<const RenameAction*> copy_actions;
+    size_t failures = 0;
+    for (const RenameAction& action : plan) {
+        double size_mb = static_cast<double>(action.size) / (1024 * 1024);
+        std::error_code ec;
+        switch (action.kind) {
+        case RenameKind::AlreadyNamed:
+            fmt::format_to(out, "文件已是正确格式，跳过: {}\n", action.from);
+            break;
+        case RenameKind::RemoveDuplicate:
+            fmt::format_to(out, "发现同名且内容相同的重复文件，删除源文件: {}\n", action.from);
+            ++counters.removes;
+            fs::remove(dir / action.from, ec);
+            if (ec) {
+                fmt::format_to(err, "处理文件冲突时出错 '{}': {}\n", action.from, ec.message());
+                ++failures;
+            }
+            break;
+        case RenameKind::Rename:
+        case RenameKind::RenameSuffixed:
+            ++counters.renames;
+            rename_no_replace(dir / action.from, dest / action.to, ec);
+            if (ec == std::errc::cross_device_link) {
+                // 目标在另一个文件系统上，稍后与其它文件一起并行复制
+                copies.push_back({dir / action.from, dest / action.to, action.size, {}, 0});
+                copy_actions.push_back(&action);
+            } else if (ec) {
+                fmt::format_to(err, "重命名时出错 '{}': {}\n", action.from, ec.message());
+                ++failures;
+            } else if (moving) {
+                fmt::format_to(out, "移动: {} -> {} (大小: {:.2f} MB)\n", action.from, (dest / action.to).string(),
+                               size_mb);
+            } else if (action.kind == RenameKind::Rename) {
+                fmt::format_to(out, "重命名: {} -> {} (大小: {:.2f} MB)\n", action.from, action.to, size_mb);
+            } else {
+                fmt::format_to(out, "重命名(添加后缀): {} -> {} (大小: {:.2f} MB)\n", action.from, action.to, size_mb);
+            }
+            break;
+        }
+    }
+
+    if (copies.empty()) {
+        return failures;
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    copy_across(copies, io_depth, counters);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    uintmax_t bytes = 0;
+    for (size_t i = 0; i < copies.size(); ++i) {
+        const CopyJob& job = copies[i];
+        const RenameAction& action = *copy_actions[i];
+        if (job.ec) {
+            fmt::format_to(err, "跨文件系统移动时出错 '{}': {}\n", action.from, job.ec.message());
+            ++failures;
+            continue;
+        }
+        bytes += job.size;
+        double mb = static_cast<double>(job.size) / (1024 * 1024);
+        fmt::format_to(out, "移动(跨文件系统): {} -> {} (大小: {:.2f} MB, {:.1f} MB/s)\n", action.from,
+                       job.to.string(), mb, mb / std::max(job.seconds, 1e-9));
+    }
+    fmt::format_to(out, "跨文件系统复制: {} 个文件, {:.2f} MB, {:.2f} s, {:.1f} MB/s (并行 {})\n", copies.size(),
+                   static_cast<double>(bytes) / (1024 * 1024), seconds,
+                   static_cast<double>(bytes) / (1024 * 1024) / std::max(seconds, 1e-9), io_depth);
+    return failures;
+}
+
+fs::path resolve_dest(const fs::path& dir, const MoveOptions& move) {
+    std::error_code ec;
+    if (move.dest.empty() || fs::equivalent(dir, move.dest, ec)) {
+        return dir;
+    }
+    return move.dest;
+}
+
+void process_directory(const fs::path& dir, const std::string& show, const std::string& skip_name,
+                       const DedupOptions& dedup_options, const MoveOptions& move, DirResult& result,
+                       OutputLog& log) {
+    const fs::path dest = resolve_dest(dir, move);
+    std::vector<DirEntry> entries = snapshot_directory(dir, result.counters, log);
+    for (const DirEntry& entry : entries) {
+        result.files += entry.has_episode;
+    }
+    RenamePlanner planner(show, skip_name, dir, dest);
+    if (planner.same_dir()) {
+        for (const DirEntry& entry : entries) {
+            planner.add_existing(entry);
+        }
+    } else {
+        for (const DirEntry& entry : snapshot_directory(dest, result.counters, log)) {
+            planner.add_existing(entry);
+        }
+    }
+    DuplicateChecker dedup(dedup_options);
+    std::vector<RenameAction> plan = plan_batch(planner, entries, dedup);
+    result.dedup += dedup.stats();
+    execute_plan(dir, dest, plan, move.io_depth, result.counters, log);
+}
+
+void print_fs_stats(const DirResult& result, double seconds) {
+    const FsCounters& c = result.counters;
+    const DedupStats& d = result.dedup;
+    fmt::print("系统调用: {} 次, 用时 {:.3f} ms\n", c.total() + d.syscalls, seconds * 1000);
+    fmt::print("  目录: open/close {}, getdents64 {}\n", 2 * c.dir_opens, c.dir_reads);
+    fmt::print("  statx {} (含季集标记的文件 {}, 每个文件 {:.2f} 次)\n", c.stats, result.files,
+               result.files ? static_cast<double>(c.stats) / result.files : 0.0);
+    fmt::print("  rename {}, remove {}\n", c.renames, c.removes);
+    if (c.copies > 0) {
+        fmt::print("  跨文件系统复制 {} 次 ({} 个文件, {:.2f} MB)\n", c.copy_syscalls, c.copies,
+                   static_cast<double>(c.bytes_copied) / (1024 * 1024));
+    }
+    if (d.compared > 0) {
+        fmt::print("  重复检查 {} 次 (比较 {} 对, 抽样 {} 个文件, 全量哈希 {} 个文件, 读取 {:.2f} MB)\n", d.syscalls,
+                   d.compared, d.sampled, d.full_hashed, static_cast<double>(d.bytes_read) / (1024 * 1024));
+    }
+}
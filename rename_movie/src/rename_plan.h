@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "content_hash.h"
+#include "dir_scan.h"
+#include "episode_matcher.h"
+#include "move_engine.h"
+
+// 处理一个目录的输出；多个目录并行处理时先缓存，再按目录顺序打印
+struct OutputLog {
+    std::string out;
+    std::string err;
+
+    // 写到 stdout/stderr 并清空
+    void flush();
+};
+
+/**
+ * @brief 读取一次目录 (scan_directory)，得到按名字排序的所有条目的快照，读取大小失败的文件记录到 log。
+ *
+ * 之后的冲突检测都在内存中完成；只有含季集标记的常规文件会读取一次大小。
+ */
+std::vector<DirEntry> snapshot_directory(const std::filesystem::path& dir, FsCounters& counters, OutputLog& log);
+
+enum class RenameKind {
+    AlreadyNamed,     // 已是正确格式
+    Rename,           // 直接重命名
+    RenameSuffixed,   // 目标已存在且内容不同，添加 (n) 后缀
+    RemoveDuplicate,  // 目标已存在且内容相同，删除源文件
+};
+
+struct RenameAction {
+    RenameKind kind;
+    std::string from;  // 源目录中的文件名
+    std::string to;    // 目标目录中的文件名；RemoveDuplicate 时为已存在的同名文件
+    uintmax_t size = 0;
+};
+
+/**
+ * @brief 在内存中维护目录里的文件名，为含季集标记的文件决定新名字。
+ *
+ * 文件名放入哈希表，每规划一步都同步更新哈希表 (源文件名移除，目标文件名
+ * 加入)，所以后面的文件会看到前面的重命名结果。每个基础文件名记录下一个
+ * 可用的 (n) 编号，大量重复文件也不会反复从 (1) 开始探测。目标已存在且
+ * 大小相同时，由 DuplicateChecker 比较内容 (只读取文件，不修改目录)。
+ *
+ * 目标目录与源目录不同时 (--dest)，哈希表中是目标目录的名字，源文件名不在
+ * 其中，名字正确的文件也要移动。
+ *
+ * 规划器的状态可以跨多批文件保留 (监视模式)，每批执行后调用 settle()。
+ */
+class RenamePlanner {
+public:
+    // show 为新文件名的前缀 (剧名，即目录名)，skip_name 为不处理的文件 (程序自身)
+    RenamePlanner(std::string show, std::string skip_name, std::filesystem::path source,
+                  std::filesystem::path dest);
+
+    bool same_dir() const { return m_source == m_dest; }
+
+    // 记录目标目录中已有的名字；同名时更新大小
+    void add_existing(const DirEntry& entry);
+    // 名字已从目录中消失 (被删除或移走)
+    void remove_existing(const std::string& name);
+
+    /**
+     * @brief 为 entry 规划一步，不访问文件系统 (内容比较除外)。
+     * @return 文件不需要处理 (无季集标记或为程序自身) 时返回 false
+     */
+    bool plan(const DirEntry& entry, DuplicateChecker& dedup, RenameAction& action);
+
+    // 本批计划已执行：新名字对应的文件内容此后就在新名字下
+    void settle();
+
+    // entry 的规范目标名：剧名.SxxExx.后缀
+    std::string target_name(const DirEntry& entry) const;
+
+private:
+    // sized 表示已知大小 (可做重复比较)；origin 为该名字的内容在计划执行前
+    // 所在的路径
+    struct NameInfo {
+        bool sized;
+        uintmax_t size;
+        std::filesystem::path origin;
+    };
+
+    std::string m_show;
+    std::string m_skip_name;
+    std::filesystem::path m_source;
+    std::filesystem::path m_dest;
+    std::unordered_map<std::string, NameInfo> m_names;
+    // 旧版本命名的文件名 -> 它占用的规范名字
+    std::unordered_map<std::string, std::string> m_aliases;
+    // 每个 "基础文件名/后缀" 下一个要尝试的 (n) 编号
+    std::unordered_map<std::string, int> m_next_suffix;
+    std::vector<std::string> m_unsettled;  // 本批新加入的名字
+};
+
+// 用 entries 中需要处理的文件生成一批计划
+std::vector<RenameAction> plan_batch(RenamePlanner& planner, const std::vector<DirEntry>& entries,
+                                     DuplicateChecker& dedup);
+
+/**
+ * @brief 按顺序执行计划并记录每一步，单个文件出错不影响其它文件。
+ *
+ * rename 不覆盖已有文件；跨文件系统 (EXDEV) 的文件在其它步骤完成后由
+ * copy_across() 并行复制。
+ *
+ * @return 失败的步骤数
+ */
+size_t execute_plan(const std::filesystem::path& dir, const std::filesystem::path& dest,
+                    const std::vector<RenameAction>& plan, unsigned io_depth, FsCounters& counters, OutputLog& log);
+
+// 一个或多个目录的处理结果
+struct DirResult {
+    FsCounters counters;
+    DedupStats dedup;
+    uint64_t files = 0;  // 含季集标记的文件
+
+    DirResult& operator+=(const DirResult& other) {
+        counters += other.counters;
+        dedup += other.dedup;
+        files += other.files;
+        return *this;
+    }
+};
+
+// --stats：打印系统调用次数和用时
+void print_fs_stats(const DirResult& result, double seconds);
+
+// 目标目录：move.dest 为空或与 dir 是同一目录时为 dir 本身
+std::filesystem::path resolve_dest(const std::filesystem::path& dir, const MoveOptions& move);
+
+/**
+ * @brief 对一个目录执行 快照 -> 计划 -> 重命名，目录内的重命名按计划顺序串行执行。
+ *
+ * 指定了 move.dest 时同时读取目标目录的快照，文件移动到目标目录。
+ */
+void process_directory(const std::filesystem::path& dir, const std::string& show, const std::string& skip_name,
+                       const DedupOptions& dedup_options, const MoveOptions& move, DirResult& result,
+                       OutputLog& log);
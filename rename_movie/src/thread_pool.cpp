@@ -0,0 +1,79 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned t = 1; t < threads; ++t) {
+        m_workers.emplace_back(&ThreadPool::worker_loop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& th : m_workers) {
+        th.join();
+    }
+}
+
+void ThreadPool::run_tasks() {
+    for (size_t i = m_next++; i < m_count; i = m_next++) {
+        (*m_fn)(i);
+    }
+}
+
+void ThreadPool::worker_loop() {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+            if (m_stop) {
+                return;
+            }
+            seen = m_generation;
+        }
+        run_tasks();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_active == 0) {
+                m_done.notify_one();
+            }
+        }
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> job_lock(m_job_mutex);
+    if (m_workers.empty() || count == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_fn = &fn;
+        m_count = count;
+        m_next = 0;
+        m_active = static_cast<unsigned>(m_workers.size());
+        ++m_generation;
+    }
+    m_wake.notify_all();
+    run_tasks();
+
+    // fn 离开作用域之前，所有工作线程都必须退出 run_tasks()
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&] { return m_active == 0; });
+    m_fn = nullptr;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief 固定数量的工作线程，用于并行处理一批任务。
+ *
+ * 线程只创建一次，任务之间休眠。parallel_for() 通过原子计数器分发任务下标，
+ * 调用线程自己也参与执行。
+ */
+class ThreadPool {
+public:
+    // threads 为包括调用线程在内的总线程数，0 表示硬件线程数
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // 执行任务的线程数，包括 parallel_for() 的调用者
+    unsigned size() const { return static_cast<unsigned>(m_workers.size()) + 1; }
+
+    /**
+     * @brief 对 [0, count) 中的每个 i 执行 fn(i)，全部完成后返回。
+     *
+     * 多个线程同时调用时依次执行；fn 中不能再调用同一个线程池的 parallel_for()。
+     */
+    void parallel_for(size_t count, const std::function<void(size_t)>& fn);
+
+private:
+    void worker_loop();
+    void run_tasks();
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_job_mutex;  // 串行化 parallel_for() 的调用者
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    uint64_t m_generation = 0;
+    bool m_stop = false;
+    unsigned m_active = 0;   // 仍在执行当前任务的工作线程
+
+    const std::function<void(size_t)>* m_fn = nullptr;
+    size_t m_count = 0;
+    std::atomic<size_t> m_next{0};
+};
@@ -0,0 +1,363 @@
+#include "watch.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
+#include <fmt/format.h>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ONLYDIR;
+// 事件持续不断时，一批最多推迟这么多个去抖窗口
+constexpr int MAX_DEBOUNCE_WINDOWS = 10;
+
+[[noreturn]] void throw_errno(const char* what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+} // namespace
+
+DirectoryWatcher::DirectoryWatcher(WatchOptions options)
+    : m_options(std::move(options)), m_dest(resolve_dest(m_options.dir, m_options.move)),
+      m_planner(m_options.show, m_options.skip_name, m_options.dir, m_dest) {
+    m_inotify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify < 0) {
+        throw_errno("inotify_init1");
+    }
+    // 先建立监视再读取目录，两者之间落地的文件不会漏掉
+    if (::inotify_add_watch(m_inotify, m_options.dir.c_str(), WATCH_MASK) < 0) {
+        int err = errno;
+        ::close(m_inotify);
+        throw std::system_error(err, std::generic_category(), "inotify_add_watch " + m_options.dir.string());
+    }
+    m_stop = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_stop < 0) {
+        int err = errno;
+        ::close(m_inotify);
+        throw std::system_error(err, std::generic_category(), "eventfd");
+    }
+}
+
+DirectoryWatcher::~DirectoryWatcher() {
+    ::close(m_stop);
+    ::close(m_inotify);
+}
+
+void DirectoryWatcher::stop() {
+    uint64_t one = 1;
+    // 只用 async-signal-safe 的 write，信号处理函数中也可以调用
+    ssize_t n = ::write(m_stop, &one, sizeof(one));
+    (void)n;
+}
+
+void DirectoryWatcher::rescan() {
+    m_planner = RenamePlanner(m_options.show, m_options.skip_name, m_options.dir, m_dest);
+    m_pending.clear();
+    m_own_targets.clear();
+    m_overflow = false;
+
+    OutputLog log;
+    std::vector<DirEntry> entries = snapshot_directory(m_options.dir, m_result.counters, log);
+    for (const DirEntry& entry : entries) {
+        m_result.files += entry.has_episode;
+    }
+    for (const DirEntry& entry :
+         m_planner.same_dir() ? entries : snapshot_directory(m_dest, m_result.counters, log)) {
+        m_planner.add_existing(entry);
+    }
+    execute_batch(entries, log);
+}
+
+void DirectoryWatcher::execute_batch(const std::vector<DirEntry>& entries, OutputLog& log) {
+    DuplicateChecker dedup(m_options.dedup);
+    std::vector<RenameAction> plan = plan_batch(m_planner, entries, dedup);
+    m_result.dedup += dedup.stats();
+    execute_plan(m_options.dir, m_dest, plan, m_options.move.io_depth, m_result.counters, log);
+    m_planner.settle();
+    // 移动到其它目录时，监视的目录中不会出现目标名字
+    for (const RenameAction& a : plan) {
+        if (m_planner.same_dir() && (a.kind == RenameKind::Rename || a.kind == RenameKind::RenameSuffixed)) {
+            ++m_own_targets[a.to];
+        }
+    }
+    if (!m_options.quiet) {
+        log.flush();
+    }
+    if (on_batch) {
+        on_batch(plan);
+    }
+}
+
+void DirectoryWatcher::read_events() {
+    alignas(struct inotify_event) char buf[64 * 1024];
+    while (true) {
+        ssize_t len = ::read(m_inotify, buf, sizeof(buf));
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                return;
+            }
+            throw_errno("read inotify");
+        }
+        for (char* p = buf; p < buf + len;) {
+            const auto* ev = reinterpret_cast<const struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + ev->len;
+            if (ev->mask & IN_Q_OVERFLOW) {
+                m_overflow = true;
+                continue;
+            }
+            if (ev->len == 0) {
+                continue;
+            }
+            std::string name(ev->name);
+            if (ev->mask & (IN_MOVED_FROM | IN_DELETE)) {
+                // 规划器中是目标目录的名字；移动模式下与监视的目录无关
+                if (m_planner.same_dir()) {
+                    m_planner.remove_existing(name);
+                }
+            } else if (ev->mask & IN_MOVED_TO) {
+                // 自己的重命名产生的事件，规划器中已经有这个名字
+                auto own = m_own_targets.find(name);
+                if (own != m_own_targets.end()) {
+                    if (--own->second == 0) {
+                        m_own_targets.erase(own);
+                    }
+                    continue;
+                }
+                m_pending.push_back(std::move(name));
+            } else if (ev->mask & IN_CLOSE_WRITE) {
+                m_pending.push_back(std::move(name));
+            }
+        }
+    }
+}
+
+void DirectoryWatcher::process_batch() {
+    OutputLog log;
+    std::vector<DirEntry> entries;
+    std::unordered_set<std::string> seen;
+    for (std::string& name : m_pending) {
+        if (!seen.insert(name).second) {
+            continue;
+        }
+        DirEntry entry;
+        if (!stat_entry(m_options.dir, name, entry, m_result.counters)) {
+            // 处理之前已被删除或移走
+            if (m_planner.same_dir()) {
+                m_planner.remove_existing(name);
+            }
+            continue;
+        }
+        if (m_planner.same_dir()) {
+            m_planner.add_existing(entry);
+        }
+        if (entry.has_episode) {
+            ++m_result.files;
+            entries.push_back(std::move(entry));
+        }
+    }
+    m_pending.clear();
+
+    if (!m_planner.same_dir()) {
+        // 目标目录不在监视范围内，其它程序可能在启动后放入同名文件：规划前
+        // 重新读取本批文件的目标名字，否则规划器不知道它们已存在 (rename 报 EEXIST)
+        for (const DirEntry& entry : entries) {
+            std::string target = m_planner.target_name(entry);
+            DirEntry existing;
+            if (stat_entry(m_dest, target, existing, m_result.counters)) {
+                m_planner.add_existing(existing);
+            } else {
+                m_planner.remove_existing(target);
+            }
+        }
+    }
+    execute_batch(entries, log);
+}
+
+void DirectoryWatcher::run() {
+    rescan();
+
+    struct pollfd fds[2] = {{m_inotify, POLLIN, 0}, {m_stop, POLLIN, 0}};
+    const auto debounce = std::chrono::milliseconds(m_options.debounce_ms);
+    Clock::time_point first{};
+    Clock::time_point last{};
+    while (true) {
+        int timeout = -1;
+        if (!m_pending.empty() || m_overflow) {
+            Clock::time_point deadline = std::min(last + debounce, first + MAX_DEBOUNCE_WINDOWS * debounce);
+            auto wait = std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now());
+            timeout = static_cast<int>(std::max<int64_t>(0, wait.count()));
+        }
+        int n = ::poll(fds, 2, timeout);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw_errno("poll");
+        }
+        if (fds[1].revents & POLLIN) {
+            uint64_t value;
+            ssize_t r = ::read(m_stop, &value, sizeof(value));
+            (void)r;
+            return;
+        }
+        if (fds[0].revents & POLLIN) {
+            bool idle = m_pending.empty() && !m_overflow;
+            read_events();
+            last = Clock::now();
+            if (idle) {
+                first = last;
+            }
+            continue;
+        }
+        // 去抖窗口内没有新事件
+        if (m_overflow) {
+            fmt::print(stderr, "inotify 事件队列溢出，重新扫描目录\n");
+            rescan();
+        } else if (!m_pending.empty()) {
+            process_batch();
+        }
+    }
+}
+
+namespace {
+
+DirectoryWatcher* g_watcher = nullptr;
+
+void handle_stop_signal(int) {
+    if (g_watcher != nullptr) {
+        g_watcher->stop();
+    }
+}
+
+} // namespace
+
+int run_watch(const WatchOptions& options) {
+    DirectoryWatcher watcher(options);
+    fmt::print("监视目录: {} (剧名 {}, 去抖 {} ms)，Ctrl+C 退出\n", options.dir.string(), options.show,
+               options.debounce_ms);
+    std::fflush(stdout);
+
+    g_watcher = &watcher;
+    struct sigaction sa {};
+    sa.sa_handler = handle_stop_signal;
+    sigemptyset(&sa.sa_mask);
+    ::sigaction(SIGINT, &sa, nullptr);
+    ::sigaction(SIGTERM, &sa, nullptr);
+
+    auto t0 = Clock::now();
+    watcher.run();
+    g_watcher = nullptr;
+
+    double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+    fmt::print("\n监视结束: 运行 {:.1f} s, 处理 {} 个文件\n", seconds, watcher.result().files);
+    if (options.stats) {
+        print_fs_stats(watcher.result(), seconds);
+    }
+    return 0;
+}
+
+int bench_watch(size_t count, int debounce_ms) {
+    std::string tmpl = (fs::temp_directory_path() / "rename_movie_watch_XXXXXX").string();
+    if (::mkdtemp(tmpl.data()) == nullptr) {
+        throw_errno("mkdtemp");
+    }
+    const fs::path dir = tmpl;
+
+    WatchOptions options;
+    options.dir = dir;
+    options.show = "Bench";
+    options.debounce_ms = debounce_ms;
+    options.quiet = true;
+    DirectoryWatcher watcher(options);
+
+    // 每个源文件名重命名执行完成的时间
+    std::mutex mutex;
+    std::condition_variable renamed;
+    std::unordered_map<std::string, Clock::time_point> done;
+    watcher.on_batch = [&](const std::vector<RenameAction>& plan) {
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const RenameAction& a : plan) {
+            done.emplace(a.from, now);
+        }
+        renamed.notify_all();
+    };
+
+    // run() 会先处理一次已有的文件 (空目录)，需要的话会有一批空回调
+    std::thread thread([&] { watcher.run(); });
+
+    auto write_file = [&](const std::string& name) {
+        std::FILE* f = std::fopen((dir / name).c_str(), "wb");
+        if (f == nullptr) {
+            throw_errno("fopen");
+        }
+        std::fputs(name.c_str(), f);
+        // IN_CLOSE_WRITE 在 close 中产生，在此之前取时间
+        Clock::time_point closing = Clock::now();
+        std::fclose(f);
+        return closing;
+    };
+    auto name_of = [](const char* group, size_t i) {
+        return fmt::format("{}.s{:02}e{:02}.720p.mkv", group, 1 + i / 100, i % 100);
+    };
+    auto wait_for = [&](const std::string& name) {
+        std::unique_lock<std::mutex> lock(mutex);
+        renamed.wait(lock, [&] { return done.count(name) != 0; });
+        return done[name];
+    };
+
+    // 逐个写入：每个文件写完后等它被重命名，得到单个事件的延迟
+    std::vector<double> latency_ms;
+    latency_ms.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string name = name_of("single", i);
+        Clock::time_point closed = write_file(name);
+        Clock::time_point finished = wait_for(name);
+        latency_ms.push_back(std::chrono::duration<double, std::milli>(finished - closed).count());
+    }
+
+    // 突发写入：一次写入 count 个文件，测量全部重命名完成的时间
+    auto burst_start = Clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        write_file(name_of("burst", i));
+    }
+    Clock::time_point burst_end = burst_start;
+    for (size_t i = 0; i < count; ++i) {
+        burst_end = std::max(burst_end, wait_for(name_of("burst", i)));
+    }
+    double burst_s = std::chrono::duration<double>(burst_end - burst_start).count();
+
+    watcher.stop();
+    thread.join();
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+
+    std::sort(latency_ms.begin(), latency_ms.end());
+    auto pct = [&](double p) {
+        return latency_ms.empty() ? 0.0 : latency_ms[std::min(latency_ms.size() - 1, size_t(p * latency_ms.size()))];
+    };
+    fmt::print("去抖窗口: {} ms, 文件数: {}\n", debounce_ms, count);
+    fmt::print("逐个写入 close->rename 延迟: p50 {:.2f} ms, p90 {:.2f} ms, p99 {:.2f} ms, 最大 {:.2f} ms\n",
+               pct(0.50), pct(0.90), pct(0.99), latency_ms.empty() ? 0.0 : latency_ms.back());
+    fmt::print("突发写入 {} 个文件: 全部重命名用时 {:.2f} ms ({:.0f} 个文件/秒)\n", count, burst_s * 1000,
+               count / std::max(burst_s, 1e-9));
+    return 0;
+}
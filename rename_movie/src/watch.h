@@ -0,0 +1,75 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "content_hash.h"
+#include "move_engine.h"
+#include "rename_plan.h"
+
+struct WatchOptions {
+    std::filesystem::path dir;
+    std::string show;        // 新文件名的前缀，默认为目录名
+    std::string skip_name;   // 不处理的文件 (程序自身)
+    int debounce_ms = 500;   // 最后一个事件之后等待多久再处理这一批
+    bool quiet = false;      // 不打印每个文件的处理结果
+    bool stats = false;      // 结束时打印系统调用次数
+    DedupOptions dedup;
+    MoveOptions move;        // 指定目标目录时，重命名后移动到目标目录
+};
+
+/**
+ * @brief 用 inotify 监视一个目录，新文件写完 (IN_CLOSE_WRITE) 或移入
+ * (IN_MOVED_TO) 后重命名。
+ *
+ * 启动时读取一次目录建立 RenamePlanner，此后只根据事件更新：新文件只 stat
+ * 自己，删除/移出的名字从规划器中去掉，不再重新扫描整个目录 (仅在 inotify
+ * 队列溢出时重新扫描)。事件在 debounce_ms 内合并为一批，连续不断的事件最多
+ * 推迟 10 个窗口。没有事件时阻塞在 poll() 上，不占用 CPU。
+ */
+class DirectoryWatcher {
+public:
+    // inotify 初始化失败时抛出 std::system_error
+    explicit DirectoryWatcher(WatchOptions options);
+    ~DirectoryWatcher();
+    DirectoryWatcher(const DirectoryWatcher&) = delete;
+    DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+    // 阻塞处理事件，直到 stop() 被调用
+    void run();
+    // 可以在其它线程或信号处理函数中调用
+    void stop();
+
+    // 每批执行完成后调用 (在 run() 的线程中)
+    std::function<void(const std::vector<RenameAction>&)> on_batch;
+
+    const DirResult& result() const { return m_result; }
+
+private:
+    void rescan();
+    void read_events();
+    void process_batch();
+    // 规划并执行一批文件 (已加入规划器)，执行后调用 on_batch
+    void execute_batch(const std::vector<DirEntry>& entries, OutputLog& log);
+
+    WatchOptions m_options;
+    std::filesystem::path m_dest;  // 监视的目录或 --dest 目录
+    int m_inotify = -1;
+    int m_stop = -1;           // eventfd
+    RenamePlanner m_planner;
+    DirResult m_result;
+    std::vector<std::string> m_pending;                  // 本批待处理的名字
+    std::unordered_map<std::string, int> m_own_targets;  // 自己重命名产生、应忽略的 IN_MOVED_TO
+    bool m_overflow = false;
+};
+
+// 监视模式入口：SIGINT/SIGTERM 时退出并打印统计，返回进程退出码
+int run_watch(const WatchOptions& options);
+
+/**
+ * @brief 测量事件到重命名完成的延迟：在临时目录中逐个写入 count 个文件，
+ * 记录每个文件 close() 到其重命名执行完成的时间。
+ */
+int bench_watch(size_t count, int debounce_ms);